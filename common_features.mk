@@ -154,6 +154,10 @@ else
         # This will effectively work the same as "transient" if not supported by the chip
         SRC += $(PLATFORM_COMMON_DIR)/eeprom_teensy.c
       endif
+      ifneq ($(filter -DSTM32_EEPROM_ENABLE,$(OPT_DEFS)),)
+        # Fail the link if the firmware grows into the pages reserved for the EEPROM
+        EXTRALDFLAGS += $(TMK_PATH)/$(PLATFORM_COMMON_DIR)/eeprom_stm32.ld
+      endif
     else ifeq ($(PLATFORM),ARM_ATSAM)
       SRC += $(PLATFORM_COMMON_DIR)/eeprom.c
     else ifeq ($(PLATFORM),TEST)
@@ -420,6 +424,7 @@ ifneq ($(strip $(CUSTOM_MATRIX)), yes)
 
     # Include common stuff for all non custom matrix users
     QUANTUM_SRC += $(QUANTUM_DIR)/matrix_common.c
+    QUANTUM_SRC += $(QUANTUM_DIR)/matrix_port_scan.c
 
     # if 'lite' then skip the actual matrix implementation
     ifneq ($(strip $(CUSTOM_MATRIX)), lite)
@@ -455,7 +460,8 @@ ifeq ($(strip $(SPLIT_KEYBOARD)), yes)
     OPT_DEFS += -DSPLIT_KEYBOARD
 
     # Include files used by all split keyboards
-    QUANTUM_SRC += $(QUANTUM_DIR)/split_common/split_util.c
+    QUANTUM_SRC += $(QUANTUM_DIR)/split_common/split_util.c \
+                   $(QUANTUM_DIR)/split_common/crc8.c
 
     # Determine which (if any) transport files are required
     ifneq ($(strip $(SPLIT_TRANSPORT)), custom)
@@ -57,6 +57,168 @@ static i2c_status_t chibios_to_qmk(const msg_t* status) {
     }
 }
 
+#ifdef I2C_ASYNC_ENABLE
+enum i2c_request_type {
+    I2C_REQUEST_TRANSMIT,
+    I2C_REQUEST_RECEIVE,
+    I2C_REQUEST_READ_REG,
+};
+
+typedef struct {
+    uint8_t        type;
+    uint8_t        address;
+    uint16_t       tx_length;
+    uint16_t       rx_length;
+    uint16_t       timeout;
+    const uint8_t* tx_data;
+    uint8_t*       rx;
+    i2c_callback_t callback;
+    void*          context;
+    uint8_t        tx[I2C_ASYNC_DATA_SIZE];
+} i2c_request_t;
+
+// Requests are processed in order by I2CAsyncThread, the request at the
+// head stays in the queue until it has completed. Only one thread may queue
+// requests, and callbacks run on I2CAsyncThread so must not use I2C themselves.
+static i2c_request_t      i2c_queue[I2C_ASYNC_QUEUE_SIZE];
+static uint8_t            i2c_queue_head  = 0;
+static uint8_t            i2c_queue_count = 0;
+static thread_reference_t i2c_worker      = NULL;
+static thread_reference_t i2c_waiting     = NULL;
+static thread_t*          i2c_thread      = NULL;
+
+static THD_WORKING_AREA(waI2CAsyncThread, I2C_ASYNC_THREAD_STACK);
+static THD_FUNCTION(I2CAsyncThread, arg) {
+    (void)arg;
+    chRegSetThreadName("i2c_async");
+
+    while (true) {
+        chSysLock();
+        if (i2c_queue_count == 0) {
+            chThdSuspendS(&i2c_worker);
+        }
+        chSysUnlock();
+
+        i2c_request_t* request = &i2c_queue[i2c_queue_head];
+        msg_t          status;
+
+        // The driver sleeps on the DMA transfer, so other threads keep running meanwhile
+        i2cStart(&I2C_DRIVER, &i2cconfig);
+        switch (request->type) {
+            case I2C_REQUEST_TRANSMIT:
+                status = i2cMasterTransmitTimeout(&I2C_DRIVER, (request->address >> 1), request->tx_data, request->tx_length, 0, 0, TIME_MS2I(request->timeout));
+                break;
+            case I2C_REQUEST_RECEIVE:
+                status = i2cMasterReceiveTimeout(&I2C_DRIVER, (request->address >> 1), request->rx, request->rx_length, TIME_MS2I(request->timeout));
+                break;
+            default:
+                status = i2cMasterTransmitTimeout(&I2C_DRIVER, (request->address >> 1), request->tx_data, request->tx_length, request->rx, request->rx_length, TIME_MS2I(request->timeout));
+                break;
+        }
+        if (request->callback) {
+            request->callback(chibios_to_qmk(&status), request->context);
+        }
+
+        chSysLock();
+        i2c_queue_head = (i2c_queue_head + 1) % I2C_ASYNC_QUEUE_SIZE;
+        i2c_queue_count--;
+        chThdResumeS(&i2c_waiting, MSG_OK);
+        chSysUnlock();
+    }
+}
+
+// Returns the next free slot, waiting for one if the queue is full
+static i2c_request_t* i2c_request_reserve(uint8_t type, uint8_t address, uint16_t timeout, i2c_callback_t callback, void* context) {
+    if (!i2c_thread) {
+        i2c_thread = chThdCreateStatic(waI2CAsyncThread, sizeof(waI2CAsyncThread), I2C_ASYNC_THREAD_PRIORITY, I2CAsyncThread, NULL);
+    }
+
+    chSysLock();
+    while (i2c_queue_count == I2C_ASYNC_QUEUE_SIZE) {
+        chThdSuspendS(&i2c_waiting);
+    }
+    chSysUnlock();
+
+    i2c_request_t* request = &i2c_queue[(i2c_queue_head + i2c_queue_count) % I2C_ASYNC_QUEUE_SIZE];
+    request->type          = type;
+    request->address       = address;
+    request->tx_length     = 0;
+    request->rx_length     = 0;
+    request->timeout       = timeout;
+    request->tx_data       = request->tx;
+    request->rx            = NULL;
+    request->callback      = callback;
+    request->context       = context;
+    return request;
+}
+
+static i2c_status_t i2c_request_submit(void) {
+    chSysLock();
+    i2c_queue_count++;
+    chThdResumeS(&i2c_worker, MSG_OK);
+    chSysUnlock();
+    return I2C_STATUS_SUCCESS;
+}
+
+void i2c_flush(void) {
+    chSysLock();
+    while (i2c_queue_count > 0) {
+        chThdSuspendS(&i2c_waiting);
+    }
+    chSysUnlock();
+}
+
+i2c_status_t i2c_transmit_async(uint8_t address, const uint8_t* data, uint16_t length, uint16_t timeout, i2c_callback_t callback, void* context) {
+    if (length > I2C_ASYNC_DATA_SIZE) {
+        return I2C_STATUS_ERROR;
+    }
+    i2c_request_t* request = i2c_request_reserve(I2C_REQUEST_TRANSMIT, address, timeout, callback, context);
+    memcpy(request->tx, data, length);
+    request->tx_length = length;
+    return i2c_request_submit();
+}
+
+// Like i2c_transmit_async, but data is sent from the caller's buffer
+i2c_status_t i2c_transmit_async_nocopy(uint8_t address, const uint8_t* data, uint16_t length, uint16_t timeout, i2c_callback_t callback, void* context) {
+    i2c_request_t* request = i2c_request_reserve(I2C_REQUEST_TRANSMIT, address, timeout, callback, context);
+    request->tx_data       = data;
+    request->tx_length     = length;
+    return i2c_request_submit();
+}
+
+i2c_status_t i2c_receive_async(uint8_t address, uint8_t* data, uint16_t length, uint16_t timeout, i2c_callback_t callback, void* context) {
+    i2c_request_t* request = i2c_request_reserve(I2C_REQUEST_RECEIVE, address, timeout, callback, context);
+    request->rx            = data;
+    request->rx_length     = length;
+    return i2c_request_submit();
+}
+
+i2c_status_t i2c_writeReg_async(uint8_t devaddr, uint8_t regaddr, const uint8_t* data, uint16_t length, uint16_t timeout, i2c_callback_t callback, void* context) {
+    if (length + 1 > I2C_ASYNC_DATA_SIZE) {
+        return I2C_STATUS_ERROR;
+    }
+    i2c_request_t* request = i2c_request_reserve(I2C_REQUEST_TRANSMIT, devaddr, timeout, callback, context);
+    request->tx[0]         = regaddr;
+    memcpy(&request->tx[1], data, length);
+    request->tx_length = length + 1;
+    return i2c_request_submit();
+}
+
+i2c_status_t i2c_readReg_async(uint8_t devaddr, uint8_t regaddr, uint8_t* data, uint16_t length, uint16_t timeout, i2c_callback_t callback, void* context) {
+    i2c_request_t* request = i2c_request_reserve(I2C_REQUEST_READ_REG, devaddr, timeout, callback, context);
+    request->tx[0]         = regaddr;
+    request->tx_length     = 1;
+    request->rx            = data;
+    request->rx_length     = length;
+    return i2c_request_submit();
+}
+
+// Blocking calls go after everything that was queued before them
+#    define i2c_wait_async() i2c_flush()
+#else
+#    define i2c_wait_async()
+#endif
+
 __attribute__((weak)) void i2c_init(void) {
     static bool is_initialised = false;
     if (!is_initialised) {
@@ -78,12 +240,14 @@ __attribute__((weak)) void i2c_init(void) {
 }
 
 i2c_status_t i2c_start(uint8_t address) {
+    i2c_wait_async();
     i2c_address = address;
     i2cStart(&I2C_DRIVER, &i2cconfig);
     return I2C_STATUS_SUCCESS;
 }
 
 i2c_status_t i2c_transmit(uint8_t address, const uint8_t* data, uint16_t length, uint16_t timeout) {
+    i2c_wait_async();
     i2c_address = address;
     i2cStart(&I2C_DRIVER, &i2cconfig);
     msg_t status = i2cMasterTransmitTimeout(&I2C_DRIVER, (i2c_address >> 1), data, length, 0, 0, TIME_MS2I(timeout));
@@ -91,6 +255,7 @@ i2c_status_t i2c_transmit(uint8_t address, const uint8_t* data, uint16_t length,
 }
 
 i2c_status_t i2c_receive(uint8_t address, uint8_t* data, uint16_t length, uint16_t timeout) {
+    i2c_wait_async();
     i2c_address = address;
     i2cStart(&I2C_DRIVER, &i2cconfig);
     msg_t status = i2cMasterReceiveTimeout(&I2C_DRIVER, (i2c_address >> 1), data, length, TIME_MS2I(timeout));
@@ -98,11 +263,12 @@ i2c_status_t i2c_receive(uint8_t address, uint8_t* data, uint16_t length, uint16
 }
 
 i2c_status_t i2c_writeReg(uint8_t devaddr, uint8_t regaddr, const uint8_t* data, uint16_t length, uint16_t timeout) {
+    i2c_wait_async();
     i2c_address = devaddr;
     i2cStart(&I2C_DRIVER, &i2cconfig);
 
     uint8_t complete_packet[length + 1];
-    for (uint8_t i = 0; i < length; i++) {
+    for (uint16_t i = 0; i < length; i++) {
         complete_packet[i + 1] = data[i];
     }
     complete_packet[0] = regaddr;
@@ -112,10 +278,14 @@ i2c_status_t i2c_writeReg(uint8_t devaddr, uint8_t regaddr, const uint8_t* data,
 }
 
 i2c_status_t i2c_readReg(uint8_t devaddr, uint8_t regaddr, uint8_t* data, uint16_t length, uint16_t timeout) {
+    i2c_wait_async();
     i2c_address = devaddr;
     i2cStart(&I2C_DRIVER, &i2cconfig);
     msg_t status = i2cMasterTransmitTimeout(&I2C_DRIVER, (i2c_address >> 1), &regaddr, 1, data, length, TIME_MS2I(timeout));
     return chibios_to_qmk(&status);
 }
 
-void i2c_stop(void) { i2cStop(&I2C_DRIVER); }
+void i2c_stop(void) {
+    i2c_wait_async();
+    i2cStop(&I2C_DRIVER);
+}
@@ -98,6 +98,23 @@
 #    endif
 #endif
 
+#ifdef I2C_ASYNC_ENABLE
+// Number of requests that can be queued before the *_async() calls block
+#    ifndef I2C_ASYNC_QUEUE_SIZE
+#        define I2C_ASYNC_QUEUE_SIZE 16
+#    endif
+// Largest transmit that can be queued, writeReg needs one more byte for the register
+#    ifndef I2C_ASYNC_DATA_SIZE
+#        define I2C_ASYNC_DATA_SIZE 20
+#    endif
+#    ifndef I2C_ASYNC_THREAD_STACK
+#        define I2C_ASYNC_THREAD_STACK 256
+#    endif
+#    ifndef I2C_ASYNC_THREAD_PRIORITY
+#        define I2C_ASYNC_THREAD_PRIORITY (NORMALPRIO + 1)
+#    endif
+#endif
+
 typedef int16_t i2c_status_t;
 
 #define I2C_STATUS_SUCCESS (0)
@@ -111,3 +128,14 @@ i2c_status_t i2c_receive(uint8_t address, uint8_t* data, uint16_t length, uint16
 i2c_status_t i2c_writeReg(uint8_t devaddr, uint8_t regaddr, const uint8_t* data, uint16_t length, uint16_t timeout);
 i2c_status_t i2c_readReg(uint8_t devaddr, uint8_t regaddr, uint8_t* data, uint16_t length, uint16_t timeout);
 void         i2c_stop(void);
+
+#ifdef I2C_ASYNC_ENABLE
+typedef void (*i2c_callback_t)(i2c_status_t status, void* context);
+
+i2c_status_t i2c_transmit_async(uint8_t address, const uint8_t* data, uint16_t length, uint16_t timeout, i2c_callback_t callback, void* context);
+i2c_status_t i2c_transmit_async_nocopy(uint8_t address, const uint8_t* data, uint16_t length, uint16_t timeout, i2c_callback_t callback, void* context);
+i2c_status_t i2c_receive_async(uint8_t address, uint8_t* data, uint16_t length, uint16_t timeout, i2c_callback_t callback, void* context);
+i2c_status_t i2c_writeReg_async(uint8_t devaddr, uint8_t regaddr, const uint8_t* data, uint16_t length, uint16_t timeout, i2c_callback_t callback, void* context);
+i2c_status_t i2c_readReg_async(uint8_t devaddr, uint8_t regaddr, uint8_t* data, uint16_t length, uint16_t timeout, i2c_callback_t callback, void* context);
+void         i2c_flush(void);
+#endif
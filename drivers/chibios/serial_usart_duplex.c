@@ -0,0 +1,317 @@
+/* Copyright 2020 QMK
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Full duplex USART split transport
+ *
+ * Uses separate TX and RX lines, so both halves can send at any time. The
+ * serial driver moves the bytes in and out of its queues from interrupts, and
+ * a receive thread on each side handles complete frames:
+ *
+ *   start byte, transaction id, payload, CRC-8 over id and payload
+ *
+ * The payload size is known from the transaction table, so it isn't sent.
+ * soft_serial_transaction() on the master never waits for the slave. It
+ * queues a request with the initiator to target data and returns right away,
+ * handing over the newest target to initiator data that has arrived so far.
+ * The slave answers every request from its receive thread.
+ */
+
+#include "quantum.h"
+#include "serial.h"
+#include "crc8.h"
+#include "print.h"
+
+#include <string.h>
+#include <ch.h>
+#include <hal.h>
+
+#ifndef USART_CR1_M0
+#    define USART_CR1_M0 USART_CR1_M  // some platforms (f1xx) dont have this so
+#endif
+
+#ifndef USE_GPIOV1
+// The default PAL alternate modes are used to signal that the pins are used for USART
+#    ifndef SERIAL_USART_TX_PAL_MODE
+#        define SERIAL_USART_TX_PAL_MODE 7
+#    endif
+#    ifndef SERIAL_USART_RX_PAL_MODE
+#        define SERIAL_USART_RX_PAL_MODE 7
+#    endif
+#endif
+
+#ifndef SERIAL_USART_DRIVER
+#    define SERIAL_USART_DRIVER SD1
+#endif
+
+#ifndef SERIAL_USART_CR1
+#    define SERIAL_USART_CR1 (USART_CR1_PCE | USART_CR1_PS | USART_CR1_M0)  // parity enable, odd parity, 9 bit length
+#endif
+
+#ifndef SERIAL_USART_CR2
+#    define SERIAL_USART_CR2 (USART_CR2_STOP_1)  // 2 stop bits
+#endif
+
+#ifndef SERIAL_USART_CR3
+#    define SERIAL_USART_CR3 0
+#endif
+
+#if defined(SOFT_SERIAL_PIN) && !defined(SERIAL_USART_TX_PIN)
+#    define SERIAL_USART_TX_PIN SOFT_SERIAL_PIN
+#endif
+
+#ifndef SERIAL_USART_RX_PIN
+#    error SERIAL_USART_RX_PIN must be defined for the usart_duplex serial driver
+#endif
+
+#ifndef SELECT_SOFT_SERIAL_SPEED
+#    define SELECT_SOFT_SERIAL_SPEED 1
+#endif
+
+#ifdef SERIAL_USART_SPEED
+// Allow advanced users to directly set SERIAL_USART_SPEED
+#elif SELECT_SOFT_SERIAL_SPEED == 0
+#    define SERIAL_USART_SPEED 460800
+#elif SELECT_SOFT_SERIAL_SPEED == 1
+#    define SERIAL_USART_SPEED 230400
+#elif SELECT_SOFT_SERIAL_SPEED == 2
+#    define SERIAL_USART_SPEED 115200
+#elif SELECT_SOFT_SERIAL_SPEED == 3
+#    define SERIAL_USART_SPEED 57600
+#elif SELECT_SOFT_SERIAL_SPEED == 4
+#    define SERIAL_USART_SPEED 38400
+#elif SELECT_SOFT_SERIAL_SPEED == 5
+#    define SERIAL_USART_SPEED 19200
+#else
+#    error invalid SELECT_SOFT_SERIAL_SPEED value
+#endif
+
+// The largest number of transactions and the largest buffer in either direction
+#ifndef SERIAL_USART_DUPLEX_MAX_TRANSACTIONS
+#    define SERIAL_USART_DUPLEX_MAX_TRANSACTIONS 4
+#endif
+#ifndef SERIAL_USART_DUPLEX_MAX_PAYLOAD
+#    define SERIAL_USART_DUPLEX_MAX_PAYLOAD 32
+#endif
+
+// How long to wait for a reply before the request is sent again
+#ifndef SERIAL_USART_DUPLEX_RETRY
+#    define SERIAL_USART_DUPLEX_RETRY 5
+#endif
+
+#define TIMEOUT 100
+#define FRAME_START 0xA5
+#define FRAME_OVERHEAD 3
+
+static SerialConfig sdcfg = {
+    (SERIAL_USART_SPEED),  // speed - mandatory
+    (SERIAL_USART_CR1),    // CR1
+    (SERIAL_USART_CR2),    // CR2
+    (SERIAL_USART_CR3)     // CR3
+};
+
+static SSTD_t* Transaction_table      = NULL;
+static uint8_t Transaction_table_size = 0;
+static bool    is_initiator           = false;
+
+// Replies are stored here by the receive thread, and only copied into the
+// transaction buffers from soft_serial_transaction(), so that the main loop
+// never looks at a half written buffer.
+static uint8_t   reply_buffer[SERIAL_USART_DUPLEX_MAX_TRANSACTIONS][SERIAL_USART_DUPLEX_MAX_PAYLOAD];
+static bool      reply_ready[SERIAL_USART_DUPLEX_MAX_TRANSACTIONS];
+static bool      request_pending[SERIAL_USART_DUPLEX_MAX_TRANSACTIONS];
+static systime_t request_time[SERIAL_USART_DUPLEX_MAX_TRANSACTIONS];
+static systime_t last_reply_time;
+static bool      has_reply = false;
+
+static uint8_t build_frame(uint8_t* frame, uint8_t id, const uint8_t* data, uint8_t size) {
+    frame[0] = FRAME_START;
+    frame[1] = id;
+    memcpy(&frame[2], data, size);
+    frame[2 + size] = crc8(0, &frame[1], size + 1);
+    return size + FRAME_OVERHEAD;
+}
+
+static uint8_t incoming_size(SSTD_t* trans) { return is_initiator ? trans->target2initiator_buffer_size : trans->initiator2target_buffer_size; }
+
+/** \brief Waits for the next valid frame
+ *
+ * Anything that isn't a complete frame with a matching CRC is skipped, and
+ * the search for a start byte goes on from there.
+ */
+static uint8_t receive_frame(uint8_t* payload) {
+    while (true) {
+        if (sdGet(&SERIAL_USART_DRIVER) != FRAME_START) {
+            continue;
+        }
+        uint8_t id = sdGet(&SERIAL_USART_DRIVER);
+        if (id >= Transaction_table_size) {
+            continue;
+        }
+        uint8_t size = incoming_size(&Transaction_table[id]);
+        if (size) {
+            sdRead(&SERIAL_USART_DRIVER, payload, size);
+        }
+        uint8_t crc = sdGet(&SERIAL_USART_DRIVER);
+        if (crc == crc8(crc8(0, &id, 1), payload, size)) {
+            return id;
+        }
+        dprintf("serial::usart_duplex CRC error\n");
+    }
+}
+
+/*
+ * On the slave this thread answers the requests of the master, on the master
+ * it collects the replies.
+ */
+static THD_WORKING_AREA(waReceiveThread, 512);
+static THD_FUNCTION(ReceiveThread, arg) {
+    (void)arg;
+    chRegSetThreadName("usart_duplex");
+
+    uint8_t payload[SERIAL_USART_DUPLEX_MAX_PAYLOAD];
+    uint8_t frame[SERIAL_USART_DUPLEX_MAX_PAYLOAD + FRAME_OVERHEAD];
+
+    while (true) {
+        uint8_t id    = receive_frame(payload);
+        SSTD_t* trans = &Transaction_table[id];
+
+        if (is_initiator) {
+            chSysLock();
+            memcpy(reply_buffer[id], payload, trans->target2initiator_buffer_size);
+            reply_ready[id]     = true;
+            request_pending[id] = false;
+            last_reply_time     = chVTGetSystemTimeX();
+            has_reply           = true;
+            chSysUnlock();
+        } else {
+            chSysLock();
+            memcpy(trans->initiator2target_buffer, payload, trans->initiator2target_buffer_size);
+            uint8_t length = build_frame(frame, id, trans->target2initiator_buffer, trans->target2initiator_buffer_size);
+            chSysUnlock();
+
+            if (trans->status) {
+                *trans->status = TRANSACTION_ACCEPTED;
+            }
+            // Also sent for transactions without any data, so the master knows we are alive
+            sdWrite(&SERIAL_USART_DRIVER, frame, length);
+        }
+    }
+}
+
+__attribute__((weak)) void usart_init(void) {
+#if defined(USE_GPIOV1)
+    palSetLineMode(SERIAL_USART_TX_PIN, PAL_MODE_STM32_ALTERNATE_PUSHPULL);
+    palSetLineMode(SERIAL_USART_RX_PIN, PAL_MODE_INPUT_PULLUP);
+#else
+    palSetLineMode(SERIAL_USART_TX_PIN, PAL_MODE_ALTERNATE(SERIAL_USART_TX_PAL_MODE) | PAL_STM32_OTYPE_PUSHPULL);
+    palSetLineMode(SERIAL_USART_RX_PIN, PAL_MODE_ALTERNATE(SERIAL_USART_RX_PAL_MODE) | PAL_STM32_PUPDR_PULLUP);
+#endif
+}
+
+static void usart_duplex_init(SSTD_t* sstd_table, int sstd_table_size) {
+    Transaction_table      = sstd_table;
+    Transaction_table_size = 0;
+    // Transactions that don't fit are left out
+    while (Transaction_table_size < sstd_table_size && Transaction_table_size < SERIAL_USART_DUPLEX_MAX_TRANSACTIONS) {
+        SSTD_t* trans = &sstd_table[Transaction_table_size];
+        if (trans->initiator2target_buffer_size > SERIAL_USART_DUPLEX_MAX_PAYLOAD || trans->target2initiator_buffer_size > SERIAL_USART_DUPLEX_MAX_PAYLOAD) {
+            break;
+        }
+        Transaction_table_size++;
+    }
+    if (Transaction_table_size < sstd_table_size) {
+        dprintf("serial::usart_duplex transaction table too large\n");
+    }
+
+    usart_init();
+    sdStart(&SERIAL_USART_DRIVER, &sdcfg);
+
+    // Slightly above the main loop, so frames are picked up as soon as they are complete
+    chThdCreateStatic(waReceiveThread, sizeof(waReceiveThread), NORMALPRIO + 1, ReceiveThread, NULL);
+}
+
+void soft_serial_initiator_init(SSTD_t* sstd_table, int sstd_table_size) {
+    is_initiator = true;
+    usart_duplex_init(sstd_table, sstd_table_size);
+}
+
+void soft_serial_target_init(SSTD_t* sstd_table, int sstd_table_size) {
+    is_initiator = false;
+    usart_duplex_init(sstd_table, sstd_table_size);
+}
+
+// Queues the frame only if all of it fits, never waits for the USART
+static bool send_frame_nonblocking(uint8_t* frame, uint8_t length) {
+    chSysLock();
+    bool fits = oqGetEmptyI(&SERIAL_USART_DRIVER.oqueue) >= length;
+    chSysUnlock();
+    // Only this thread writes to the queue on the master, so the space can't shrink meanwhile
+    return fits && sdAsynchronousWrite(&SERIAL_USART_DRIVER, frame, length) == length;
+}
+
+/////////
+//  start transaction by initiator
+//
+// int  soft_serial_transaction(int sstd_index)
+//
+// Transactions that bring data back return the newest data received so far,
+// and TRANSACTION_END as long as the slave keeps answering. Transactions that
+// only send data return TRANSACTION_END once their data is on its way.
+//
+// Returns:
+//    TRANSACTION_END
+//    TRANSACTION_NO_RESPONSE
+//    TRANSACTION_TYPE_ERROR
+#ifndef SERIAL_USE_MULTI_TRANSACTION
+int soft_serial_transaction(void) {
+    uint8_t sstd_index = 0;
+#else
+int soft_serial_transaction(int index) {
+    uint8_t sstd_index = index;
+#endif
+
+    if (sstd_index >= Transaction_table_size) return TRANSACTION_TYPE_ERROR;
+    SSTD_t*   trans = &Transaction_table[sstd_index];
+    systime_t now   = chVTGetSystemTimeX();
+
+    chSysLock();
+    if (reply_ready[sstd_index]) {
+        memcpy(trans->target2initiator_buffer, reply_buffer[sstd_index], trans->target2initiator_buffer_size);
+        reply_ready[sstd_index] = false;
+    }
+    bool connected = has_reply && chVTTimeElapsedSinceX(last_reply_time) < TIME_MS2I(TIMEOUT);
+    // Keep a single request per transaction in flight, the reply carries the newest data anyway
+    bool send = !trans->target2initiator_buffer_size || !request_pending[sstd_index] || chVTTimeElapsedSinceX(request_time[sstd_index]) >= TIME_MS2I(SERIAL_USART_DUPLEX_RETRY);
+    chSysUnlock();
+
+    bool sent = false;
+    if (send) {
+        uint8_t frame[SERIAL_USART_DUPLEX_MAX_PAYLOAD + FRAME_OVERHEAD];
+        uint8_t length = build_frame(frame, sstd_index, trans->initiator2target_buffer, trans->initiator2target_buffer_size);
+        sent           = send_frame_nonblocking(frame, length);
+        if (sent) {
+            chSysLock();
+            request_pending[sstd_index] = true;
+            request_time[sstd_index]    = now;
+            chSysUnlock();
+        }
+    }
+
+    if (!connected || (!trans->target2initiator_buffer_size && !sent)) {
+        return TRANSACTION_NO_RESPONSE;
+    }
+    return TRANSACTION_END;
+}
@@ -1,5 +1,6 @@
 #include "quantum.h"
 #include "ws2812.h"
+#include <string.h>
 
 /* Adapted from https://github.com/gamazeps/ws2812b-chibios-SPIDMA/ */
 
@@ -39,41 +40,56 @@
 #define RESET_SIZE (1000 * WS2812_TRST_US / (2 * 1250))
 #define PREAMBLE_SIZE 4
 
-static uint8_t txbuf[PREAMBLE_SIZE + DATA_SIZE + RESET_SIZE] = {0};
+#define TXBUF_SIZE (PREAMBLE_SIZE + DATA_SIZE + RESET_SIZE)
+
+#ifdef WS2812_SPI_SYNC
+static uint8_t txbuf[1][TXBUF_SIZE] = {{0}};
+#else
+// While one buffer is sent by the DMA, the next frame is written to the other
+static uint8_t txbuf[2][TXBUF_SIZE] = {{0}};
+#endif
+static uint8_t txbuf_index = 0;
+
+#ifndef WS2812_SPI_SYNC
+static volatile bool txbuf_sending = false;
+
+static void spi_end_cb(SPIDriver* spip) { txbuf_sending = false; }
+#endif
 
 /*
  * As the trick here is to use the SPI to send a huge pattern of 0 and 1 to
- * the ws2812b protocol, we use this helper function to translate bytes into
- * 0s and 1s for the LED (with the appropriate timing).
+ * the ws2812b protocol, every pair of bits of a color byte is sent as one SPI
+ * byte, with the appropriate timing for the LED.
  */
-static uint8_t get_protocol_eq(uint8_t data, int pos) {
-    uint8_t eq = 0;
-    if (data & (1 << (2 * (3 - pos))))
-        eq = 0b1110;
-    else
-        eq = 0b1000;
-    if (data & (2 << (2 * (3 - pos))))
-        eq += 0b11100000;
-    else
-        eq += 0b10000000;
-    return eq;
+static const uint8_t protocol_eq[4] = {
+    0b10001000,  // 00
+    0b10001110,  // 01
+    0b11101000,  // 10
+    0b11101110,  // 11
+};
+
+static inline void set_led_byte(uint8_t* tx, uint8_t data) {
+    tx[0] = protocol_eq[(data >> 6) & 0b11];
+    tx[1] = protocol_eq[(data >> 4) & 0b11];
+    tx[2] = protocol_eq[(data >> 2) & 0b11];
+    tx[3] = protocol_eq[data & 0b11];
 }
 
 static void set_led_color_rgb(LED_TYPE color, int pos) {
-    uint8_t* tx_start = &txbuf[PREAMBLE_SIZE];
+    uint8_t* tx_start = &txbuf[txbuf_index][PREAMBLE_SIZE + BYTES_FOR_LED * pos];
 
 #if (WS2812_BYTE_ORDER == WS2812_BYTE_ORDER_GRB)
-    for (int j = 0; j < 4; j++) tx_start[BYTES_FOR_LED * pos + j] = get_protocol_eq(color.g, j);
-    for (int j = 0; j < 4; j++) tx_start[BYTES_FOR_LED * pos + BYTES_FOR_LED_BYTE + j] = get_protocol_eq(color.r, j);
-    for (int j = 0; j < 4; j++) tx_start[BYTES_FOR_LED * pos + BYTES_FOR_LED_BYTE * 2 + j] = get_protocol_eq(color.b, j);
+    set_led_byte(tx_start, color.g);
+    set_led_byte(tx_start + BYTES_FOR_LED_BYTE, color.r);
+    set_led_byte(tx_start + BYTES_FOR_LED_BYTE * 2, color.b);
 #elif (WS2812_BYTE_ORDER == WS2812_BYTE_ORDER_RGB)
-    for (int j = 0; j < 4; j++) tx_start[BYTES_FOR_LED * pos + j] = get_protocol_eq(color.r, j);
-    for (int j = 0; j < 4; j++) tx_start[BYTES_FOR_LED * pos + BYTES_FOR_LED_BYTE + j] = get_protocol_eq(color.g, j);
-    for (int j = 0; j < 4; j++) tx_start[BYTES_FOR_LED * pos + BYTES_FOR_LED_BYTE * 2 + j] = get_protocol_eq(color.b, j);
+    set_led_byte(tx_start, color.r);
+    set_led_byte(tx_start + BYTES_FOR_LED_BYTE, color.g);
+    set_led_byte(tx_start + BYTES_FOR_LED_BYTE * 2, color.b);
 #elif (WS2812_BYTE_ORDER == WS2812_BYTE_ORDER_BGR)
-    for (int j = 0; j < 4; j++) tx_start[BYTES_FOR_LED * pos + j] = get_protocol_eq(color.b, j);
-    for (int j = 0; j < 4; j++) tx_start[BYTES_FOR_LED * pos + BYTES_FOR_LED_BYTE + j] = get_protocol_eq(color.g, j);
-    for (int j = 0; j < 4; j++) tx_start[BYTES_FOR_LED * pos + BYTES_FOR_LED_BYTE * 2 + j] = get_protocol_eq(color.r, j);
+    set_led_byte(tx_start, color.b);
+    set_led_byte(tx_start + BYTES_FOR_LED_BYTE, color.g);
+    set_led_byte(tx_start + BYTES_FOR_LED_BYTE * 2, color.r);
 #endif
 }
 
@@ -82,7 +98,11 @@ void ws2812_init(void) {
 
     // TODO: more dynamic baudrate
     static const SPIConfig spicfg = {
+#ifdef WS2812_SPI_SYNC
         0, NULL, PAL_PORT(RGB_DI_PIN), PAL_PAD(RGB_DI_PIN),
+#else
+        0, spi_end_cb, PAL_PORT(RGB_DI_PIN), PAL_PAD(RGB_DI_PIN),
+#endif
         SPI_CR1_BR_1 | SPI_CR1_BR_0  // baudrate : fpclk / 8 => 1tick is 0.32us (2.25 MHz)
     };
 
@@ -102,11 +122,22 @@ void ws2812_setleds(LED_TYPE* ledarray, uint16_t leds) {
         set_led_color_rgb(ledarray[i], i);
     }
 
-    // Send async - each led takes ~0.03ms, 50 leds ~1.5ms, animations flushing faster than send will cause issues.
-    // Instead spiSend can be used to send synchronously (or the thread logic can be added back).
 #ifdef WS2812_SPI_SYNC
-    spiSend(&WS2812_SPI, sizeof(txbuf) / sizeof(txbuf[0]), txbuf);
+    spiSend(&WS2812_SPI, TXBUF_SIZE, txbuf[0]);
 #else
-    spiStartSend(&WS2812_SPI, sizeof(txbuf) / sizeof(txbuf[0]), txbuf);
+    // Send async - each led takes ~0.03ms, 50 leds ~1.5ms. The previous frame
+    // may still be going out if animations flush faster than that, only then
+    // this has to wait for it.
+    while (txbuf_sending) {
+    }
+    txbuf_sending = true;
+    spiStartSend(&WS2812_SPI, TXBUF_SIZE, txbuf[txbuf_index]);
+
+    // Keep the LEDs the caller didn't pass as they were in the frame just sent
+    uint8_t next = txbuf_index ^ 1;
+    if (leds < RGBLED_NUM) {
+        memcpy(&txbuf[next][PREAMBLE_SIZE + BYTES_FOR_LED * leds], &txbuf[txbuf_index][PREAMBLE_SIZE + BYTES_FOR_LED * leds], BYTES_FOR_LED * (RGBLED_NUM - leds));
+    }
+    txbuf_index = next;
 #endif
 }
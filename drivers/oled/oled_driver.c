@@ -122,6 +122,9 @@ uint32_t oled_scroll_timeout;
 #if OLED_UPDATE_INTERVAL > 0
 uint16_t oled_update_timeout;
 #endif
+#if OLED_FRAME_INTERVAL > 0
+uint16_t oled_frame_timeout;
+#endif
 
 // Internal variables to reduce math instructions
 
@@ -270,17 +273,161 @@ static void rotate_90(const uint8_t *src, uint8_t *dest) {
     }
 }
 
+#ifdef OLED_FULL_FRAME_RENDER
+// The display memory as it looks in 90 degree rotation. Blocks are only
+// rotated again when they have changed, the rest is sent from here as is.
+static uint8_t oled_rotated_buffer[OLED_MATRIX_SIZE];
+
+#    if !defined(__AVR__) && (OLED_IC != OLED_IC_SH1106)
+// i2c_writeReg would copy the frame to the stack, so it is put together here
+// instead, starting with the data control byte. The AVR driver sends as it goes.
+static uint8_t oled_transfer[OLED_MATRIX_SIZE + 1];
+#    endif
+
+#    if defined(I2C_ASYNC_ENABLE) && (OLED_IC != OLED_IC_SH1106)
+#        define OLED_ASYNC_RENDER
+// The frame in oled_transfer is being sent by the I2C thread
+static OLED_BLOCK_TYPE oled_transfer_blocks = 0;
+static volatile bool   oled_transfer_busy   = false;
+static volatile bool   oled_transfer_failed = false;
+
+static void oled_transfer_done(i2c_status_t status, void *context) {
+    oled_transfer_failed = (status != I2C_STATUS_SUCCESS);
+    oled_transfer_busy   = false;
+}
+
+// Marks the blocks of a failed frame dirty again, so they go out with the next one
+static void oled_retry_failed_transfer(void) {
+    if (oled_transfer_failed) {
+        oled_transfer_failed = false;
+        oled_dirty |= oled_transfer_blocks;
+    }
+}
+#    endif
+
+// Rotates a block into oled_rotated_buffer, and widens the page range to include it
+static void rotate_block_90(uint8_t block, uint8_t *first_page, uint8_t *last_page) {
+    const static uint8_t source_map[] = OLED_SOURCE_MAP;
+    const static uint8_t target_map[] = OLED_TARGET_MAP;
+
+    static uint8_t temp_buffer[OLED_BLOCK_SIZE];
+    memset(temp_buffer, 0, sizeof(temp_buffer));
+    for (uint8_t i = 0; i < sizeof(source_map); ++i) {
+        rotate_90(&oled_buffer[OLED_BLOCK_SIZE * block + source_map[i]], &temp_buffer[target_map[i]]);
+    }
+
+    // Put it in the same window the block renderer would have sent it to
+    uint8_t bounds[6];
+    calc_bounds_90(block, bounds);
+    uint8_t        width = bounds[2] - bounds[1] + 1;
+    const uint8_t *data  = temp_buffer;
+    for (uint8_t page = bounds[4]; page <= bounds[5]; page++) {
+        memcpy(&oled_rotated_buffer[page * OLED_DISPLAY_WIDTH + bounds[1]], data, width);
+        data += width;
+    }
+
+    if (bounds[4] < *first_page) *first_page = bounds[4];
+    if (bounds[5] > *last_page) *last_page = bounds[5];
+}
+
+// Sends every dirty block at once, as a single transfer of the pages they are on
+static void oled_render_frame(void) {
+#    ifdef OLED_ASYNC_RENDER
+    // The previous frame is still on its way
+    if (oled_transfer_busy) {
+        return;
+    }
+#    endif
+
+    OLED_BLOCK_TYPE blocks     = oled_dirty;
+    const uint8_t * source     = oled_buffer;
+    uint8_t         first_page = UINT8_MAX;
+    uint8_t         last_page  = 0;
+    for (uint8_t i = 0; i < OLED_BLOCK_COUNT; i++) {
+        if (!(blocks & ((OLED_BLOCK_TYPE)1 << i))) {
+            continue;
+        }
+        if (!HAS_FLAGS(oled_rotation, OLED_ROTATION_90)) {
+            uint8_t start = OLED_BLOCK_SIZE * i / OLED_DISPLAY_WIDTH;
+            uint8_t end   = (OLED_BLOCK_SIZE * (i + 1) - 1) / OLED_DISPLAY_WIDTH;
+            if (start < first_page) first_page = start;
+            if (end > last_page) last_page = end;
+        } else {
+            source = oled_rotated_buffer;
+            rotate_block_90(i, &first_page, &last_page);
+        }
+    }
+
+#    if (OLED_IC == OLED_IC_SH1106)
+    // Page Addressing Mode doesn't move on to the next page by itself, so address each one
+    for (uint8_t page = first_page; page <= last_page; page++) {
+        uint8_t display_start[] = {I2C_CMD, PAM_PAGE_ADDR | page, PAM_SETCOLUMN_LSB | (OLED_COLUMN_OFFSET & 0x0f), PAM_SETCOLUMN_MSB | (OLED_COLUMN_OFFSET >> 4 & 0x0f)};
+        if (I2C_TRANSMIT(display_start) != I2C_STATUS_SUCCESS) {
+            print("oled_render offset command failed\n");
+            return;
+        }
+        if (I2C_WRITE_REG(I2C_DATA, &source[page * OLED_DISPLAY_WIDTH], OLED_DISPLAY_WIDTH) != I2C_STATUS_SUCCESS) {
+            print("oled_render data failed\n");
+            return;
+        }
+    }
+#    else
+    uint16_t start           = first_page * OLED_DISPLAY_WIDTH;
+    uint16_t length          = (last_page - first_page + 1) * OLED_DISPLAY_WIDTH;
+    uint8_t  display_start[] = {I2C_CMD, COLUMN_ADDR, 0, OLED_DISPLAY_WIDTH - 1, PAGE_ADDR, first_page, last_page};
+#        ifdef OLED_ASYNC_RENDER
+    // Queue the frame, the I2C thread sends it while the matrix keeps being scanned
+    oled_transfer[0] = I2C_DATA;
+    memcpy(&oled_transfer[1], &source[start], length);
+    oled_transfer_blocks = blocks;
+    oled_transfer_busy   = true;
+    i2c_transmit_async((OLED_DISPLAY_ADDRESS << 1), display_start, sizeof(display_start), OLED_I2C_TIMEOUT, NULL, NULL);
+    i2c_transmit_async_nocopy((OLED_DISPLAY_ADDRESS << 1), oled_transfer, length + 1, OLED_I2C_TIMEOUT, oled_transfer_done, NULL);
+#        else
+    if (I2C_TRANSMIT(display_start) != I2C_STATUS_SUCCESS) {
+        print("oled_render offset command failed\n");
+        return;
+    }
+#            if defined(__AVR__)
+    i2c_status_t status = I2C_WRITE_REG(I2C_DATA, &source[start], length);
+#            else
+    oled_transfer[0] = I2C_DATA;
+    memcpy(&oled_transfer[1], &source[start], length);
+    i2c_status_t status = i2c_transmit((OLED_DISPLAY_ADDRESS << 1), oled_transfer, length + 1, OLED_I2C_TIMEOUT);
+#            endif
+    if (status != I2C_STATUS_SUCCESS) {
+        print("oled_render data failed\n");
+        return;
+    }
+#        endif
+#    endif
+
+    // Turn on display if it is off
+    oled_on();
+
+    // Clear dirty flags, anything written since then stays dirty for the next frame
+    oled_dirty &= ~blocks;
+}
+#endif
+
 void oled_render(void) {
     if (!oled_initialized) {
         return;
     }
 
+#ifdef OLED_ASYNC_RENDER
+    oled_retry_failed_transfer();
+#endif
+
     // Do we have work to do?
     oled_dirty &= OLED_ALL_BLOCKS_MASK;
     if (!oled_dirty || oled_scrolling) {
         return;
     }
 
+#ifdef OLED_FULL_FRAME_RENDER
+    oled_render_frame();
+#else
     // Find first dirty block
     uint8_t update_start = 0;
     while (!(oled_dirty & ((OLED_BLOCK_TYPE)1 << update_start))) {
@@ -330,6 +477,7 @@ void oled_render(void) {
 
     // Clear dirty flag
     oled_dirty &= ~((OLED_BLOCK_TYPE)1 << update_start);
+#endif
 }
 
 void oled_set_cursor(uint8_t col, uint8_t line) {
@@ -701,8 +849,21 @@ void oled_task(void) {
     }
 #endif
 
+#ifdef OLED_ASYNC_RENDER
+    // Before the frame interval check, which only looks at oled_dirty
+    oled_retry_failed_transfer();
+#endif
+
     // Smart render system, no need to check for dirty
+#if OLED_FRAME_INTERVAL > 0
+    // Only the first change after an idle period is sent right away
+    if (oled_dirty && timer_elapsed(oled_frame_timeout) >= OLED_FRAME_INTERVAL) {
+        oled_frame_timeout = timer_read();
+        oled_render();
+    }
+#else
     oled_render();
+#endif
 
     // Display timeout check
 #if OLED_TIMEOUT > 0
@@ -154,6 +154,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #    endif
 #endif
 
+// Minimum time between two rendered frames in ms, 0 renders on every oled_task()
+#if !defined(OLED_FRAME_INTERVAL)
+#    if defined(OLED_FULL_FRAME_RENDER)
+#        define OLED_FRAME_INTERVAL 40
+#    else
+#        define OLED_FRAME_INTERVAL 0
+#    endif
+#endif
+
 #if !defined(OLED_I2C_TIMEOUT)
 #    define OLED_I2C_TIMEOUT 100
 #endif
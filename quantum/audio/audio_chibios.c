@@ -357,20 +357,65 @@ void stop_note(float freq) {
     }
 }
 
+/* Everything below runs from the GPT8 callback, in interrupt context. The
+ * Cortex-M4 FPU only handles single precision, so stay away from pow() and
+ * fmod(), which promote to double and end up in software emulation.
+ */
+
+/** \brief Frequency ratio for one glissando step
+ *
+ * Approximates 2^(440 / freq / 24), the ratio the glissando moves by on every
+ * tick, with a short series for e^y. y stays below 0.42 for any audible
+ * frequency, where the error of the series is around 0.01%.
+ */
+static float glissando_step(float freq) {
+    float y = 0.69314718f * 440.0f / 24.0f / freq;
+    return 1.0f + y * (1.0f + y / 2.0f * (1.0f + y / 3.0f * (1.0f + y / 4.0f)));
+}
+
+/** \brief Moves current towards target by one glissando step
+ */
+static float glissando_towards(float current, float target) {
+    if (current != 0) {
+        float step = glissando_step(target);
+        if (current < target / step) {
+            return current * glissando_step(current);
+        } else if (current > target * step) {
+            return current / glissando_step(current);
+        }
+    }
+    return target;
+}
+
 #ifdef VIBRATO_ENABLE
 
-float mod(float a, int b) {
-    float r = fmod(a, b);
-    return r < 0 ? r + b : r;
+#    ifdef VIBRATO_STRENGTH_ENABLE
+// vibrato_lut raised to vibrato_strength, recomputed whenever the strength changes
+static float vibrato_strength_lut[VIBRATO_LUT_LENGTH];
+static float vibrato_strength_lut_strength = -1;
+
+static void update_vibrato_strength_lut(void) {
+    if (vibrato_strength_lut_strength == vibrato_strength) {
+        return;
+    }
+    for (uint8_t i = 0; i < VIBRATO_LUT_LENGTH; i++) {
+        vibrato_strength_lut[i] = powf(vibrato_lut[i], vibrato_strength);
+    }
+    vibrato_strength_lut_strength = vibrato_strength;
 }
+#    endif
 
 float vibrato(float average_freq) {
 #    ifdef VIBRATO_STRENGTH_ENABLE
-    float vibrated_freq = average_freq * pow(vibrato_lut[(int)vibrato_counter], vibrato_strength);
+    float vibrated_freq = average_freq * vibrato_strength_lut[(int)vibrato_counter];
 #    else
     float vibrated_freq = average_freq * vibrato_lut[(int)vibrato_counter];
 #    endif
-    vibrato_counter = mod((vibrato_counter + vibrato_rate * (1.0 + 440.0 / average_freq)), VIBRATO_LUT_LENGTH);
+    // The counter moves by less than the length of the table per tick
+    vibrato_counter += vibrato_rate * (1.0f + 440.0f / average_freq);
+    while (vibrato_counter >= VIBRATO_LUT_LENGTH) {
+        vibrato_counter -= VIBRATO_LUT_LENGTH;
+    }
     return vibrated_freq;
 }
 
@@ -385,13 +430,7 @@ static void gpt_cb8(GPTDriver *gptp) {
             if (voices > 1) {
                 if (polyphony_rate == 0) {
                     if (glissando) {
-                        if (frequency_alt != 0 && frequency_alt < frequencies[voices - 2] && frequency_alt < frequencies[voices - 2] * pow(2, -440 / frequencies[voices - 2] / 12 / 2)) {
-                            frequency_alt = frequency_alt * pow(2, 440 / frequency_alt / 12 / 2);
-                        } else if (frequency_alt != 0 && frequency_alt > frequencies[voices - 2] && frequency_alt > frequencies[voices - 2] * pow(2, 440 / frequencies[voices - 2] / 12 / 2)) {
-                            frequency_alt = frequency_alt * pow(2, -440 / frequency_alt / 12 / 2);
-                        } else {
-                            frequency_alt = frequencies[voices - 2];
-                        }
+                        frequency_alt = glissando_towards(frequency_alt, frequencies[voices - 2]);
                     } else {
                         frequency_alt = frequencies[voices - 2];
                     }
@@ -445,13 +484,7 @@ static void gpt_cb8(GPTDriver *gptp) {
 #endif
             } else {
                 if (glissando) {
-                    if (frequency != 0 && frequency < frequencies[voices - 1] && frequency < frequencies[voices - 1] * pow(2, -440 / frequencies[voices - 1] / 12 / 2)) {
-                        frequency = frequency * pow(2, 440 / frequency / 12 / 2);
-                    } else if (frequency != 0 && frequency > frequencies[voices - 1] && frequency > frequencies[voices - 1] * pow(2, 440 / frequencies[voices - 1] / 12 / 2)) {
-                        frequency = frequency * pow(2, -440 / frequency / 12 / 2);
-                    } else {
-                        frequency = frequencies[voices - 1];
-                    }
+                    frequency = glissando_towards(frequency, frequencies[voices - 1]);
                 } else {
                     frequency = frequencies[voices - 1];
                 }
@@ -587,6 +620,9 @@ void play_note(float freq, int vol) {
             voices++;
         }
 
+#if defined(VIBRATO_ENABLE) && defined(VIBRATO_STRENGTH_ENABLE)
+        update_vibrato_strength_lut();
+#endif
         gptStart(&GPTD8, &gpt8cfg1);
         gptStartContinuous(&GPTD8, 2U);
         RESTART_CHANNEL_1();
@@ -618,6 +654,9 @@ void play_notes(float (*np)[][2], uint16_t n_count, bool n_repeat) {
         note_length    = ((*notes_pointer)[current_note][1] / 4) * (((float)note_tempo) / 100);
         note_position  = 0;
 
+#if defined(VIBRATO_ENABLE) && defined(VIBRATO_STRENGTH_ENABLE)
+        update_vibrato_strength_lut();
+#endif
         gptStart(&GPTD8, &gpt8cfg1);
         gptStartContinuous(&GPTD8, 2U);
         RESTART_CHANNEL_1();
@@ -661,11 +700,20 @@ void decrease_vibrato_rate(float change) { vibrato_rate /= change; }
 
 #    ifdef VIBRATO_STRENGTH_ENABLE
 
-void set_vibrato_strength(float strength) { vibrato_strength = strength; }
+void set_vibrato_strength(float strength) {
+    vibrato_strength = strength;
+    update_vibrato_strength_lut();
+}
 
-void increase_vibrato_strength(float change) { vibrato_strength *= change; }
+void increase_vibrato_strength(float change) {
+    vibrato_strength *= change;
+    update_vibrato_strength_lut();
+}
 
-void decrease_vibrato_strength(float change) { vibrato_strength /= change; }
+void decrease_vibrato_strength(float change) {
+    vibrato_strength /= change;
+    update_vibrato_strength_lut();
+}
 
 #    endif /* VIBRATO_STRENGTH_ENABLE */
 
@@ -0,0 +1,127 @@
+/*
+Copyright 2020 QMK
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+Symmetric per-key algorithm using vertical counters.
+Behaves like sym_defer_pk: when a key hasn't changed for DEBOUNCE milliseconds, its state is pushed.
+Instead of a counter per key, bit n of every key's counter is stored in the same matrix_row_t,
+so a whole row is counted and compared with a handful of bitwise operations.
+*/
+
+#include "matrix.h"
+#include "timer.h"
+#include "quantum.h"
+
+#ifndef DEBOUNCE
+#    define DEBOUNCE 5
+#endif
+
+#if DEBOUNCE > 0
+
+#    if DEBOUNCE < 2
+#        define COUNTER_BITS 1
+#    elif DEBOUNCE < 4
+#        define COUNTER_BITS 2
+#    elif DEBOUNCE < 8
+#        define COUNTER_BITS 3
+#    elif DEBOUNCE < 16
+#        define COUNTER_BITS 4
+#    elif DEBOUNCE < 32
+#        define COUNTER_BITS 5
+#    elif DEBOUNCE < 64
+#        define COUNTER_BITS 6
+#    elif DEBOUNCE < 128
+#        define COUNTER_BITS 7
+#    else
+#        define COUNTER_BITS 8
+#    endif
+
+#    if DEBOUNCE > 255
+#        error DEBOUNCE must be less than 256 for sym_defer_pk_vc
+#    endif
+
+// counters[row][bit] holds bit "bit" of the counters of every key in the row
+static matrix_row_t counters[MATRIX_ROWS][COUNTER_BITS];
+// keys that were already waiting at the previous scan, only those count the time since then
+static matrix_row_t waiting[MATRIX_ROWS];
+static bool         counters_need_update;
+static uint16_t     last_time;
+
+// Adds one to the counters of the keys in mask, then pushes the keys that reached DEBOUNCE
+static inline matrix_row_t count_row(matrix_row_t counter[], matrix_row_t mask) {
+    matrix_row_t carry   = mask;
+    matrix_row_t elapsed = mask;
+    for (uint8_t bit = 0; bit < COUNTER_BITS; bit++) {
+        matrix_row_t next = counter[bit] & carry;
+        counter[bit] ^= carry;
+        carry = next;
+        elapsed &= (DEBOUNCE & (1 << bit)) ? counter[bit] : ~counter[bit];
+    }
+    for (uint8_t bit = 0; bit < COUNTER_BITS; bit++) {
+        counter[bit] &= ~elapsed;
+    }
+    return elapsed;
+}
+
+void debounce_init(uint8_t num_rows) {}
+
+void debounce(matrix_row_t raw[], matrix_row_t cooked[], uint8_t num_rows, bool changed) {
+    if (!changed && !counters_need_update) {
+        last_time = timer_read();
+        return;
+    }
+
+    uint16_t now   = timer_read();
+    uint16_t ticks = TIMER_DIFF_16(now, last_time);
+    last_time      = now;
+    if (ticks > DEBOUNCE) {
+        ticks = DEBOUNCE;
+    }
+
+    counters_need_update = false;
+    for (uint8_t row = 0; row < num_rows; row++) {
+        matrix_row_t  delta    = raw[row] ^ cooked[row];
+        matrix_row_t  counting = delta & waiting[row];
+        matrix_row_t *counter  = counters[row];
+
+        // keys that went back to their debounced state start over
+        for (uint8_t bit = 0; bit < COUNTER_BITS; bit++) {
+            counter[bit] &= counting;
+        }
+        for (uint16_t i = 0; i < ticks && counting; i++) {
+            matrix_row_t elapsed = count_row(counter, counting);
+            cooked[row] ^= elapsed;
+            counting &= ~elapsed;
+            delta &= ~elapsed;
+        }
+        waiting[row] = delta;
+        if (delta) {
+            counters_need_update = true;
+        }
+    }
+}
+
+#else
+
+void debounce_init(uint8_t num_rows) {}
+
+void debounce(matrix_row_t raw[], matrix_row_t cooked[], uint8_t num_rows, bool changed) {
+    for (uint8_t row = 0; row < num_rows; row++) {
+        cooked[row] = raw[row];
+    }
+}
+
+#endif
+
+bool debounce_active(void) { return true; }
@@ -14,6 +14,8 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <string.h>
+
 #include "config.h"
 #include "keymap.h"  // to get keymaps[][][]
 #include "tmk_core/common/eeprom.h"
@@ -47,6 +49,13 @@
 #    error DYNAMIC_KEYMAP_EEPROM_MAX_ADDR must be less than 65536
 #endif
 
+// The emulated EEPROM on STM32 is sized by eeprom_stm32.h, check that it covers
+// every address dynamic keymaps may write to, or those writes would be dropped.
+#ifdef STM32_EEPROM_ENABLE
+#    include "eeprom_stm32.h"
+_Static_assert(FEE_DENSITY_BYTES >= DYNAMIC_KEYMAP_EEPROM_MAX_ADDR + 1, "DYNAMIC_KEYMAP_EEPROM_MAX_ADDR is beyond the emulated EEPROM, reduce it or increase FEE_DENSITY_BYTES");
+#endif
+
 // If DYNAMIC_KEYMAP_EEPROM_ADDR not explicitly defined in config.h,
 // default it start after VIA_EEPROM_CUSTOM_ADDR+VIA_EEPROM_CUSTOM_SIZE
 #ifndef DYNAMIC_KEYMAP_EEPROM_ADDR
@@ -77,6 +86,97 @@
 #    define DYNAMIC_KEYMAP_MACRO_EEPROM_SIZE (DYNAMIC_KEYMAP_EEPROM_MAX_ADDR - DYNAMIC_KEYMAP_MACRO_EEPROM_ADDR + 1)
 #endif
 
+// Size of the keymaps in EEPROM, in bytes
+#define DYNAMIC_KEYMAP_EEPROM_SIZE (DYNAMIC_KEYMAP_LAYER_COUNT * MATRIX_ROWS * MATRIX_COLS * 2)
+
+#ifdef DYNAMIC_KEYMAP_CACHE
+// With DYNAMIC_KEYMAP_CACHE defined, the keymaps and macros are mirrored in RAM,
+// so that looking up a keycode never has to touch the EEPROM. Changes are made
+// to the RAM copy and written back to the EEPROM a block at a time, once no
+// changes have been made for DYNAMIC_KEYMAP_CACHE_WRITE_DELAY milliseconds.
+// This costs as much RAM as the EEPROM area used, so is mostly useful on ARM,
+// where EEPROM is emulated in flash or is an external I2C/SPI part.
+#    ifndef DYNAMIC_KEYMAP_CACHE_WRITE_DELAY
+#        define DYNAMIC_KEYMAP_CACHE_WRITE_DELAY 1000
+#    endif
+
+#    define DYNAMIC_KEYMAP_CACHE_BLOCK_SIZE 16
+#    define DYNAMIC_KEYMAP_CACHE_KEYMAP_BLOCKS ((DYNAMIC_KEYMAP_EEPROM_SIZE + DYNAMIC_KEYMAP_CACHE_BLOCK_SIZE - 1) / DYNAMIC_KEYMAP_CACHE_BLOCK_SIZE)
+#    define DYNAMIC_KEYMAP_CACHE_MACRO_BLOCKS ((DYNAMIC_KEYMAP_MACRO_EEPROM_SIZE + DYNAMIC_KEYMAP_CACHE_BLOCK_SIZE - 1) / DYNAMIC_KEYMAP_CACHE_BLOCK_SIZE)
+#    define DYNAMIC_KEYMAP_CACHE_BLOCKS (DYNAMIC_KEYMAP_CACHE_KEYMAP_BLOCKS + DYNAMIC_KEYMAP_CACHE_MACRO_BLOCKS)
+
+static uint16_t keymap_cache[DYNAMIC_KEYMAP_LAYER_COUNT][MATRIX_ROWS][MATRIX_COLS];
+static uint8_t  macro_cache[DYNAMIC_KEYMAP_MACRO_EEPROM_SIZE];
+static uint8_t  cache_dirty_blocks[(DYNAMIC_KEYMAP_CACHE_BLOCKS + 7) / 8];
+static bool     cache_loaded = false;
+static bool     cache_dirty  = false;
+static uint16_t cache_write_timer;
+
+// Keycodes are stored big endian in EEPROM
+static uint8_t keymap_cache_read_byte(uint16_t offset) {
+    uint16_t keycode = ((uint16_t *)keymap_cache)[offset / 2];
+    return (offset & 1) ? (keycode & 0xFF) : (keycode >> 8);
+}
+
+static void keymap_cache_write_byte(uint16_t offset, uint8_t value) {
+    uint16_t *keycode = &((uint16_t *)keymap_cache)[offset / 2];
+    if (offset & 1) {
+        *keycode = (*keycode & 0xFF00) | value;
+    } else {
+        *keycode = (*keycode & 0x00FF) | (value << 8);
+    }
+}
+
+static void cache_mark_dirty(uint16_t block) {
+    cache_dirty_blocks[block / 8] |= 1 << (block % 8);
+    cache_dirty       = true;
+    cache_write_timer = timer_read();
+}
+
+static void cache_load(void) {
+    void *source = (void *)DYNAMIC_KEYMAP_EEPROM_ADDR;
+    for (uint16_t offset = 0; offset < DYNAMIC_KEYMAP_EEPROM_SIZE; offset++) {
+        keymap_cache_write_byte(offset, eeprom_read_byte(source++));
+    }
+    eeprom_read_block(macro_cache, (void *)DYNAMIC_KEYMAP_MACRO_EEPROM_ADDR, DYNAMIC_KEYMAP_MACRO_EEPROM_SIZE);
+    cache_loaded = true;
+}
+
+static inline void cache_ensure_loaded(void) {
+    if (!cache_loaded) {
+        cache_load();
+    }
+}
+
+static void cache_write_block(uint16_t block) {
+    uint16_t offset = (block % DYNAMIC_KEYMAP_CACHE_KEYMAP_BLOCKS) * DYNAMIC_KEYMAP_CACHE_BLOCK_SIZE;
+    for (uint8_t i = 0; i < DYNAMIC_KEYMAP_CACHE_BLOCK_SIZE; i++, offset++) {
+        if (block < DYNAMIC_KEYMAP_CACHE_KEYMAP_BLOCKS) {
+            if (offset < DYNAMIC_KEYMAP_EEPROM_SIZE) {
+                eeprom_update_byte((void *)DYNAMIC_KEYMAP_EEPROM_ADDR + offset, keymap_cache_read_byte(offset));
+            }
+        } else {
+            if (offset < DYNAMIC_KEYMAP_MACRO_EEPROM_SIZE) {
+                eeprom_update_byte((void *)DYNAMIC_KEYMAP_MACRO_EEPROM_ADDR + offset, macro_cache[offset]);
+            }
+        }
+    }
+    cache_dirty_blocks[block / 8] &= ~(1 << (block % 8));
+}
+
+// Writes back a single dirty block, returns false when there are none left
+static bool cache_write_next_block(void) {
+    for (uint16_t block = 0; block < DYNAMIC_KEYMAP_CACHE_BLOCKS; block++) {
+        if (cache_dirty_blocks[block / 8] & (1 << (block % 8))) {
+            cache_write_block(block);
+            return true;
+        }
+    }
+    cache_dirty = false;
+    return false;
+}
+#endif
+
 uint8_t dynamic_keymap_get_layer_count(void) { return DYNAMIC_KEYMAP_LAYER_COUNT; }
 
 void *dynamic_keymap_key_to_eeprom_address(uint8_t layer, uint8_t row, uint8_t column) {
@@ -85,18 +185,40 @@ void *dynamic_keymap_key_to_eeprom_address(uint8_t layer, uint8_t row, uint8_t c
 }
 
 uint16_t dynamic_keymap_get_keycode(uint8_t layer, uint8_t row, uint8_t column) {
+#ifdef DYNAMIC_KEYMAP_CACHE
+    if (layer >= DYNAMIC_KEYMAP_LAYER_COUNT || row >= MATRIX_ROWS || column >= MATRIX_COLS) {
+        return KC_NO;
+    }
+    cache_ensure_loaded();
+    return keymap_cache[layer][row][column];
+#else
     void *address = dynamic_keymap_key_to_eeprom_address(layer, row, column);
     // Big endian, so we can read/write EEPROM directly from host if we want
     uint16_t keycode = eeprom_read_byte(address) << 8;
     keycode |= eeprom_read_byte(address + 1);
     return keycode;
+#endif
 }
 
 void dynamic_keymap_set_keycode(uint8_t layer, uint8_t row, uint8_t column, uint16_t keycode) {
+#ifdef KEYMAP_ACTION_CACHE_LAYERS
+    keymap_action_cache_invalidate();
+#endif
+#ifdef DYNAMIC_KEYMAP_CACHE
+    if (layer >= DYNAMIC_KEYMAP_LAYER_COUNT || row >= MATRIX_ROWS || column >= MATRIX_COLS) {
+        return;
+    }
+    cache_ensure_loaded();
+    if (keymap_cache[layer][row][column] != keycode) {
+        keymap_cache[layer][row][column] = keycode;
+        cache_mark_dirty((dynamic_keymap_key_to_eeprom_address(layer, row, column) - (void *)DYNAMIC_KEYMAP_EEPROM_ADDR) / DYNAMIC_KEYMAP_CACHE_BLOCK_SIZE);
+    }
+#else
     void *address = dynamic_keymap_key_to_eeprom_address(layer, row, column);
     // Big endian, so we can read/write EEPROM directly from host if we want
     eeprom_update_byte(address, (uint8_t)(keycode >> 8));
     eeprom_update_byte(address + 1, (uint8_t)(keycode & 0xFF));
+#endif
 }
 
 void dynamic_keymap_reset(void) {
@@ -113,12 +235,19 @@ void dynamic_keymap_reset(void) {
 }
 
 void dynamic_keymap_get_buffer(uint16_t offset, uint16_t size, uint8_t *data) {
-    uint16_t dynamic_keymap_eeprom_size = DYNAMIC_KEYMAP_LAYER_COUNT * MATRIX_ROWS * MATRIX_COLS * 2;
+    uint16_t dynamic_keymap_eeprom_size = DYNAMIC_KEYMAP_EEPROM_SIZE;
     void *   source                     = (void *)(DYNAMIC_KEYMAP_EEPROM_ADDR + offset);
     uint8_t *target                     = data;
+#ifdef DYNAMIC_KEYMAP_CACHE
+    cache_ensure_loaded();
+#endif
     for (uint16_t i = 0; i < size; i++) {
         if (offset + i < dynamic_keymap_eeprom_size) {
+#ifdef DYNAMIC_KEYMAP_CACHE
+            *target = keymap_cache_read_byte(offset + i);
+#else
             *target = eeprom_read_byte(source);
+#endif
         } else {
             *target = 0x00;
         }
@@ -128,12 +257,25 @@ void dynamic_keymap_get_buffer(uint16_t offset, uint16_t size, uint8_t *data) {
 }
 
 void dynamic_keymap_set_buffer(uint16_t offset, uint16_t size, uint8_t *data) {
-    uint16_t dynamic_keymap_eeprom_size = DYNAMIC_KEYMAP_LAYER_COUNT * MATRIX_ROWS * MATRIX_COLS * 2;
+    uint16_t dynamic_keymap_eeprom_size = DYNAMIC_KEYMAP_EEPROM_SIZE;
     void *   target                     = (void *)(DYNAMIC_KEYMAP_EEPROM_ADDR + offset);
     uint8_t *source                     = data;
+#ifdef KEYMAP_ACTION_CACHE_LAYERS
+    keymap_action_cache_invalidate();
+#endif
+#ifdef DYNAMIC_KEYMAP_CACHE
+    cache_ensure_loaded();
+#endif
     for (uint16_t i = 0; i < size; i++) {
         if (offset + i < dynamic_keymap_eeprom_size) {
+#ifdef DYNAMIC_KEYMAP_CACHE
+            if (keymap_cache_read_byte(offset + i) != *source) {
+                keymap_cache_write_byte(offset + i, *source);
+                cache_mark_dirty((offset + i) / DYNAMIC_KEYMAP_CACHE_BLOCK_SIZE);
+            }
+#else
             eeprom_update_byte(target, *source);
+#endif
         }
         source++;
         target++;
@@ -156,9 +298,16 @@ uint16_t dynamic_keymap_macro_get_buffer_size(void) { return DYNAMIC_KEYMAP_MACR
 void dynamic_keymap_macro_get_buffer(uint16_t offset, uint16_t size, uint8_t *data) {
     void *   source = (void *)(DYNAMIC_KEYMAP_MACRO_EEPROM_ADDR + offset);
     uint8_t *target = data;
+#ifdef DYNAMIC_KEYMAP_CACHE
+    cache_ensure_loaded();
+#endif
     for (uint16_t i = 0; i < size; i++) {
         if (offset + i < DYNAMIC_KEYMAP_MACRO_EEPROM_SIZE) {
+#ifdef DYNAMIC_KEYMAP_CACHE
+            *target = macro_cache[offset + i];
+#else
             *target = eeprom_read_byte(source);
+#endif
         } else {
             *target = 0x00;
         }
@@ -170,9 +319,19 @@ void dynamic_keymap_macro_get_buffer(uint16_t offset, uint16_t size, uint8_t *da
 void dynamic_keymap_macro_set_buffer(uint16_t offset, uint16_t size, uint8_t *data) {
     void *   target = (void *)(DYNAMIC_KEYMAP_MACRO_EEPROM_ADDR + offset);
     uint8_t *source = data;
+#ifdef DYNAMIC_KEYMAP_CACHE
+    cache_ensure_loaded();
+#endif
     for (uint16_t i = 0; i < size; i++) {
         if (offset + i < DYNAMIC_KEYMAP_MACRO_EEPROM_SIZE) {
+#ifdef DYNAMIC_KEYMAP_CACHE
+            if (macro_cache[offset + i] != *source) {
+                macro_cache[offset + i] = *source;
+                cache_mark_dirty(DYNAMIC_KEYMAP_CACHE_KEYMAP_BLOCKS + (offset + i) / DYNAMIC_KEYMAP_CACHE_BLOCK_SIZE);
+            }
+#else
             eeprom_update_byte(target, *source);
+#endif
         }
         source++;
         target++;
@@ -180,25 +339,51 @@ void dynamic_keymap_macro_set_buffer(uint16_t offset, uint16_t size, uint8_t *da
 }
 
 void dynamic_keymap_macro_reset(void) {
+#ifdef DYNAMIC_KEYMAP_CACHE
+    cache_ensure_loaded();
+    for (uint16_t offset = 0; offset < DYNAMIC_KEYMAP_MACRO_EEPROM_SIZE; offset++) {
+        if (macro_cache[offset] != 0) {
+            macro_cache[offset] = 0;
+            cache_mark_dirty(DYNAMIC_KEYMAP_CACHE_KEYMAP_BLOCKS + offset / DYNAMIC_KEYMAP_CACHE_BLOCK_SIZE);
+        }
+    }
+#else
     void *p   = (void *)(DYNAMIC_KEYMAP_MACRO_EEPROM_ADDR);
     void *end = (void *)(DYNAMIC_KEYMAP_MACRO_EEPROM_ADDR + DYNAMIC_KEYMAP_MACRO_EEPROM_SIZE);
     while (p != end) {
         eeprom_update_byte(p, 0);
         ++p;
     }
+#endif
 }
 
+static inline uint8_t dynamic_keymap_macro_read_byte(void *p) {
+#ifdef DYNAMIC_KEYMAP_CACHE
+    return macro_cache[p - (void *)DYNAMIC_KEYMAP_MACRO_EEPROM_ADDR];
+#else
+    return eeprom_read_byte(p);
+#endif
+}
+
+#ifdef SEND_STRING_ASYNC
+static uint8_t dynamic_keymap_macro_read_char(const char *p) { return dynamic_keymap_macro_read_byte((void *)p); }
+#endif
+
 void dynamic_keymap_macro_send(uint8_t id) {
     if (id >= DYNAMIC_KEYMAP_MACRO_COUNT) {
         return;
     }
 
+#ifdef DYNAMIC_KEYMAP_CACHE
+    cache_ensure_loaded();
+#endif
+
     // Check the last byte of the buffer.
     // If it's not zero, then we are in the middle
     // of buffer writing, possibly an aborted buffer
     // write. So do nothing.
     void *p = (void *)(DYNAMIC_KEYMAP_MACRO_EEPROM_ADDR + DYNAMIC_KEYMAP_MACRO_EEPROM_SIZE - 1);
-    if (eeprom_read_byte(p) != 0) {
+    if (dynamic_keymap_macro_read_byte(p) != 0) {
         return;
     }
 
@@ -213,19 +398,24 @@ void dynamic_keymap_macro_send(uint8_t id) {
         if (p == end) {
             return;
         }
-        if (eeprom_read_byte(p) == 0) {
+        if (dynamic_keymap_macro_read_byte(p) == 0) {
             --id;
         }
         ++p;
     }
 
+#ifdef SEND_STRING_ASYNC
+    // Type the macro straight from the buffer, so long macros
+    // don't have to fit in the send_string() queue
+    send_string_from((const char *)p, 0, dynamic_keymap_macro_read_char, true);
+#else
     // Send the macro string one or three chars at a time
     // by making temporary 1 or 3 char strings
     char data[4] = {0, 0, 0, 0};
     // We already checked there was a null at the end of
     // the buffer, so this cannot go past the end
     while (1) {
-        data[0] = eeprom_read_byte(p++);
+        data[0] = dynamic_keymap_macro_read_byte(p++);
         data[1] = 0;
         // Stop at the null terminator of this macro string
         if (data[0] == 0) {
@@ -236,11 +426,51 @@ void dynamic_keymap_macro_send(uint8_t id) {
         if (data[0] == SS_TAP_CODE || data[0] == SS_DOWN_CODE || data[0] == SS_UP_CODE) {
             data[1] = data[0];
             data[0] = SS_QMK_PREFIX;
-            data[2] = eeprom_read_byte(p++);
+            data[2] = dynamic_keymap_macro_read_byte(p++);
             if (data[2] == 0) {
                 break;
             }
         }
         send_string(data);
     }
+#endif
+}
+
+// Flush any changes to the EEPROM right away, i.e. before jumping to the bootloader
+void dynamic_keymap_flush(void) {
+#ifdef DYNAMIC_KEYMAP_CACHE
+    while (cache_dirty && cache_write_next_block()) {
+    }
+#endif
+}
+
+// Called from keyboard_init() once bootmagic may have cleared the EEPROM,
+// so that the first key press doesn't have to read the whole keymap
+void dynamic_keymap_init(void) {
+#ifdef DYNAMIC_KEYMAP_CACHE
+    dynamic_keymap_flush();
+    cache_load();
+#endif
+}
+
+// Called when the EEPROM is reset, so that the next flush doesn't write the
+// old keymaps back over it. They are read again from EEPROM when next used.
+void dynamic_keymap_cache_invalidate(void) {
+#ifdef DYNAMIC_KEYMAP_CACHE
+    memset(cache_dirty_blocks, 0, sizeof(cache_dirty_blocks));
+    cache_dirty  = false;
+    cache_loaded = false;
+#endif
+#ifdef KEYMAP_ACTION_CACHE_LAYERS
+    keymap_action_cache_invalidate();
+#endif
+}
+
+// Called from keyboard_task(), writes back changed blocks one at a time
+void dynamic_keymap_task(void) {
+#ifdef DYNAMIC_KEYMAP_CACHE
+    if (cache_dirty && timer_elapsed(cache_write_timer) > DYNAMIC_KEYMAP_CACHE_WRITE_DELAY) {
+        cache_write_next_block();
+    }
+#endif
 }
@@ -58,3 +58,13 @@ void     dynamic_keymap_macro_set_buffer(uint16_t offset, uint16_t size, uint8_t
 void     dynamic_keymap_macro_reset(void);
 
 void dynamic_keymap_macro_send(uint8_t id);
+
+// With DYNAMIC_KEYMAP_CACHE, the keymaps are loaded into RAM by
+// dynamic_keymap_init(), and changes are written back to EEPROM by
+// dynamic_keymap_task() after a delay. dynamic_keymap_flush() writes them
+// immediately, and must be called before anything that resets the MCU.
+// dynamic_keymap_cache_invalidate() drops pending changes when the EEPROM is reset.
+void dynamic_keymap_init(void);
+void dynamic_keymap_flush(void);
+void dynamic_keymap_cache_invalidate(void);
+void dynamic_keymap_task(void);
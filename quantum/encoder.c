@@ -122,6 +122,11 @@ void encoder_read(void) {
     for (uint8_t i = 0; i < NUMBER_OF_ENCODERS; i++) {
         encoder_state[i] <<= 2;
         encoder_state[i] |= (readPin(encoders_pad_a[i]) << 0) | (readPin(encoders_pad_b[i]) << 1);
+#ifdef MATRIX_IDLE_TIMEOUT
+        if ((encoder_state[i] ^ (encoder_state[i] >> 2)) & 0x3) {
+            matrix_idle_activity();
+        }
+#endif
         encoder_update(i, encoder_state[i]);
     }
 }
@@ -41,7 +41,7 @@ extern keymap_config_t keymap_config;
 #include <inttypes.h>
 
 /* converts key to action */
-action_t action_for_key(uint8_t layer, keypos_t key) {
+static action_t decode_action(uint8_t layer, keypos_t key) {
     // 16bit keycodes - important
     uint16_t keycode = keymap_key_to_keycode(layer, key);
 
@@ -166,6 +166,72 @@ action_t action_for_key(uint8_t layer, keypos_t key) {
     return action;
 }
 
+#ifdef KEYMAP_ACTION_CACHE_LAYERS
+#    if KEYMAP_ACTION_CACHE_LAYERS > MAX_LAYER
+#        error "KEYMAP_ACTION_CACHE_LAYERS must not be more than MAX_LAYER"
+#    elif KEYMAP_ACTION_CACHE_LAYERS == MAX_LAYER
+#        define UNCACHED_LAYERS ((layer_state_t)0)
+#    else
+#        define UNCACHED_LAYERS (~(layer_state_t)0 << KEYMAP_ACTION_CACHE_LAYERS)
+#    endif
+
+// The decoded actions of the lower layers, and for every key, the layers it isn't transparent on.
+// Layers that aren't cached are always set in the mask, as they may have an action.
+static action_t      action_cache[KEYMAP_ACTION_CACHE_LAYERS][MATRIX_ROWS][MATRIX_COLS];
+static layer_state_t action_layers[MATRIX_ROWS][MATRIX_COLS];
+static bool          action_cache_valid = false;
+static uint16_t      action_cache_config;
+
+// Decoding depends on keymap_config (swapped keys, mod_config), so changes to it are picked up here too
+static void action_cache_update(void) {
+    if (action_cache_valid && action_cache_config == keymap_config.raw) {
+        return;
+    }
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            keypos_t      key    = (keypos_t){.row = row, .col = col};
+            layer_state_t layers = UNCACHED_LAYERS;
+            for (uint8_t layer = 0; layer < KEYMAP_ACTION_CACHE_LAYERS; layer++) {
+                action_t action                = decode_action(layer, key);
+                action_cache[layer][row][col] = action;
+                if (action.code != ACTION_TRANSPARENT) {
+                    layers |= (layer_state_t)1 << layer;
+                }
+            }
+            action_layers[row][col] = layers;
+        }
+    }
+    action_cache_config = keymap_config.raw;
+    action_cache_valid  = true;
+}
+
+/** \brief Rebuild the action cache on its next use
+ *
+ * Call this after changing what keymap_key_to_keycode() returns.
+ */
+void keymap_action_cache_invalidate(void) { action_cache_valid = false; }
+
+/** \brief Get the layers a key may have a non-transparent action on
+ */
+layer_state_t keymap_layers_with_action(keypos_t key) {
+    if (key.row >= MATRIX_ROWS || key.col >= MATRIX_COLS) {
+        return ~(layer_state_t)0;
+    }
+    action_cache_update();
+    return action_layers[key.row][key.col];
+}
+#endif
+
+action_t action_for_key(uint8_t layer, keypos_t key) {
+#ifdef KEYMAP_ACTION_CACHE_LAYERS
+    if (layer < KEYMAP_ACTION_CACHE_LAYERS && key.row < MATRIX_ROWS && key.col < MATRIX_COLS) {
+        action_cache_update();
+        return action_cache[layer][key.row][key.col];
+    }
+#endif
+    return decode_action(layer, key);
+}
+
 __attribute__((weak)) const uint16_t PROGMEM fn_actions[] = {
 
 };
@@ -20,6 +20,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "matrix.h"
 #include "debounce.h"
 #include "quantum.h"
+#include "scan_profile.h"
+#include "matrix_port_scan.h"
 
 #ifdef DIRECT_PINS
 static pin_t direct_pins[MATRIX_ROWS][MATRIX_COLS] = DIRECT_PINS;
@@ -95,12 +97,26 @@ static void init_pins(void) {
     for (uint8_t x = 0; x < MATRIX_COLS; x++) {
         setPinInputHigh_atomic(col_pins[x]);
     }
+#        ifdef MATRIX_PORT_SCAN
+    matrix_port_scan_init(col_pins, MATRIX_COLS);
+#        endif
 }
 
 static bool read_cols_on_row(matrix_row_t current_matrix[], uint8_t current_row) {
     // Start with a clear matrix row
     matrix_row_t current_row_value = 0;
 
+#        ifdef MATRIX_PORT_SCAN
+    // Select row and read all cols once they have settled
+    select_row(current_row);
+    current_row_value = matrix_port_scan_read_stable();
+    unselect_row(current_row);
+
+    // Pressed keys pulled cols low, wait for them to recover before the next row
+    if (current_row_value) {
+        matrix_port_scan_wait_idle();
+    }
+#        else
     // Select row and wait for row selecton to stabilize
     select_row(current_row);
     matrix_io_delay();
@@ -116,6 +132,7 @@ static bool read_cols_on_row(matrix_row_t current_matrix[], uint8_t current_row)
 
     // Unselect row
     unselect_row(current_row);
+#        endif
 
     // If the row has changed, store the row and return the changed flag.
     if (current_matrix[current_row] != current_row_value) {
@@ -186,6 +203,148 @@ static bool read_rows_on_col(matrix_row_t current_matrix[], uint8_t current_col)
 #    error DIODE_DIRECTION is not defined!
 #endif
 
+#if defined(MATRIX_IDLE_TIMEOUT) && !defined(DIRECT_PINS)
+/* Idle mode
+ *
+ * Once nothing has been pressed for MATRIX_IDLE_TIMEOUT ms, all outputs are
+ * driven low at once, so a key press anywhere pulls its input low. Until that
+ * happens a scan only reads the inputs. matrix_scan() never waits, sleeping is
+ * left to the main loop, see keyboard_idle_sleep().
+ */
+#    if (DIODE_DIRECTION == COL2ROW)
+#        define IDLE_OUTPUTS row_pins
+#        define IDLE_OUTPUT_COUNT MATRIX_ROWS
+#        define IDLE_INPUTS col_pins
+#        define IDLE_INPUT_COUNT MATRIX_COLS
+#    else
+#        define IDLE_OUTPUTS col_pins
+#        define IDLE_OUTPUT_COUNT MATRIX_COLS
+#        define IDLE_INPUTS row_pins
+#        define IDLE_INPUT_COUNT MATRIX_ROWS
+#    endif
+
+#    if defined(PROTOCOL_CHIBIOS) && PAL_USE_CALLBACKS
+#        define IDLE_INTERRUPTS
+#        ifndef MATRIX_IDLE_WAIT
+#            define MATRIX_IDLE_WAIT 10
+#        endif
+static binary_semaphore_t idle_wakeup;
+// STM32 EXTI has one channel per pad number, so only the first input on each pad gets one
+static uint16_t idle_event_pads;
+#    endif
+
+static bool     idle = false;
+static uint16_t last_activity;
+
+#    ifdef IDLE_INTERRUPTS
+static void idle_input_cb(void *arg) {
+    (void)arg;
+    chSysLockFromISR();
+    chBSemSignalI(&idle_wakeup);
+    chSysUnlockFromISR();
+}
+#    endif
+
+static bool idle_input_active(void) {
+#    if (DIODE_DIRECTION == COL2ROW) && defined(MATRIX_PORT_SCAN)
+    return matrix_port_scan_read() != 0;
+#    else
+    for (uint8_t i = 0; i < IDLE_INPUT_COUNT; i++) {
+        if (!readPin(IDLE_INPUTS[i])) {
+            return true;
+        }
+    }
+    return false;
+#    endif
+}
+
+static void idle_enter(void) {
+    for (uint8_t i = 0; i < IDLE_OUTPUT_COUNT; i++) {
+        setPinOutput_writeLow(IDLE_OUTPUTS[i]);
+    }
+#    ifdef IDLE_INTERRUPTS
+    chBSemReset(&idle_wakeup, true);
+    idle_event_pads = 0;
+    for (uint8_t i = 0; i < IDLE_INPUT_COUNT; i++) {
+        uint16_t pad = 1 << PAL_PAD(IDLE_INPUTS[i]);
+        if (!(idle_event_pads & pad)) {
+            idle_event_pads |= pad;
+            palEnableLineEvent(IDLE_INPUTS[i], PAL_EVENT_MODE_FALLING_EDGE);
+            palSetLineCallback(IDLE_INPUTS[i], idle_input_cb, NULL);
+        }
+    }
+#    endif
+    idle = true;
+}
+
+static void idle_exit(void) {
+#    ifdef IDLE_INTERRUPTS
+    for (uint8_t i = 0; i < IDLE_INPUT_COUNT; i++) {
+        uint16_t pad = 1 << PAL_PAD(IDLE_INPUTS[i]);
+        if (idle_event_pads & pad) {
+            idle_event_pads &= ~pad;
+            palDisableLineEvent(IDLE_INPUTS[i]);
+        }
+    }
+#    endif
+    for (uint8_t i = 0; i < IDLE_OUTPUT_COUNT; i++) {
+        setPinInputHigh_atomic(IDLE_OUTPUTS[i]);
+    }
+    // Let the inputs recover before scanning
+    matrix_io_delay();
+    idle = false;
+}
+
+/* Returns true if the matrix is idle and still nothing is pressed */
+static bool idle_task(void) {
+    if (!idle) {
+        return false;
+    }
+    if (!idle_input_active()) {
+        return true;
+    }
+    idle_exit();
+    last_activity = timer_read();
+    return false;
+}
+
+static void idle_update(void) {
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        if (raw_matrix[row] || matrix[row]) {
+            last_activity = timer_read();
+            return;
+        }
+    }
+    if (timer_elapsed(last_activity) >= MATRIX_IDLE_TIMEOUT) {
+        idle_enter();
+    }
+}
+
+bool matrix_is_idle(void) { return idle; }
+
+/** \brief Input that isn't on the matrix, like encoders, keeps it from going idle
+ */
+void matrix_idle_activity(void) {
+    if (idle) {
+        idle_exit();
+    }
+    last_activity = timer_read();
+}
+
+/** \brief Waits for up to MATRIX_IDLE_WAIT ms for a key press while idle
+ *
+ * Only does something on ChibiOS with PAL_USE_CALLBACKS, everywhere else
+ * there is nothing that could end the wait early.
+ */
+void matrix_idle_wait(void) {
+#    ifdef IDLE_INTERRUPTS
+    if (idle && !idle_input_active()) {
+        chBSemWaitTimeout(&idle_wakeup, TIME_MS2I(MATRIX_IDLE_WAIT));
+    }
+#    endif
+}
+#endif
+
 void matrix_init(void) {
     // initialize key pins
     init_pins();
@@ -198,12 +357,26 @@ void matrix_init(void) {
 
     debounce_init(MATRIX_ROWS);
 
+#if defined(MATRIX_IDLE_TIMEOUT) && !defined(DIRECT_PINS)
+#    ifdef IDLE_INTERRUPTS
+    chBSemObjectInit(&idle_wakeup, true);
+#    endif
+    last_activity = timer_read();
+#endif
+
     matrix_init_quantum();
 }
 
 uint8_t matrix_scan(void) {
     bool changed = false;
 
+#if defined(MATRIX_IDLE_TIMEOUT) && !defined(DIRECT_PINS)
+    if (idle_task()) {
+        matrix_scan_quantum();
+        return 0;
+    }
+#endif
+
 #if defined(DIRECT_PINS) || (DIODE_DIRECTION == COL2ROW)
     // Set row, read cols
     for (uint8_t current_row = 0; current_row < MATRIX_ROWS; current_row++) {
@@ -216,7 +389,13 @@ uint8_t matrix_scan(void) {
     }
 #endif
 
+    SCAN_PROFILE_BEGIN(PROFILE_DEBOUNCE);
     debounce(raw_matrix, matrix, MATRIX_ROWS, changed);
+    SCAN_PROFILE_END(PROFILE_DEBOUNCE);
+
+#if defined(MATRIX_IDLE_TIMEOUT) && !defined(DIRECT_PINS)
+    idle_update();
+#endif
 
     matrix_scan_quantum();
     return (uint8_t)changed;
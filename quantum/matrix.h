@@ -57,6 +57,11 @@ void matrix_print(void);
 /* delay between changing matrix pin state and reading values */
 void matrix_io_delay(void);
 
+/* idle mode, see MATRIX_IDLE_TIMEOUT */
+bool matrix_is_idle(void);
+void matrix_idle_activity(void);
+void matrix_idle_wait(void);
+
 /* power control */
 void matrix_power_up(void);
 void matrix_power_down(void);
@@ -85,6 +85,13 @@ uint8_t matrix_key_count(void) {
 
 __attribute__((weak)) void matrix_io_delay(void) { wait_us(MATRIX_IO_DELAY); }
 
+// Matrices without an idle mode are never idle
+__attribute__((weak)) bool matrix_is_idle(void) { return false; }
+
+__attribute__((weak)) void matrix_idle_activity(void) {}
+
+__attribute__((weak)) void matrix_idle_wait(void) {}
+
 // CUSTOM MATRIX 'LITE'
 __attribute__((weak)) void matrix_init_custom(void) {}
 
@@ -0,0 +1,165 @@
+/* Copyright 2020 QMK
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef MATRIX_PORT_SCAN
+
+#    include "matrix_port_scan.h"
+#    include "wait.h"
+
+#    ifndef MATRIX_IO_DELAY
+#        define MATRIX_IO_DELAY 30
+#    endif
+
+/* The polls below are bounded by elapsed time, so they need a clock that is
+ * finer than a microsecond. wait_us() can't be used for that on ChibiOS, it
+ * sleeps for at least a whole system tick.
+ */
+#    if defined(__AVR__)
+// _delay_us() busy waits, so counting 1us steps is close enough
+#        define POLL_US_STEPS
+#    elif defined(PROTOCOL_CHIBIOS)
+#        include <hal.h>
+#        if !defined(MATRIX_PORT_SCAN_RT_FREQUENCY) && defined(STM32_SYSCLK)
+#            define MATRIX_PORT_SCAN_RT_FREQUENCY STM32_SYSCLK
+#        endif
+#        if PORT_SUPPORTS_RT && defined(MATRIX_PORT_SCAN_RT_FREQUENCY)
+// Busy wait on the cycle counter
+#            define POLL_DEADLINE
+#            define POLL_CYCLES_PER_US (MATRIX_PORT_SCAN_RT_FREQUENCY / 1000000)
+
+static inline rtcnt_t poll_start(void) { return chSysGetRealtimeCounterX(); }
+
+static inline bool poll_elapsed(rtcnt_t start, uint16_t us) { return (rtcnt_t)(chSysGetRealtimeCounterX() - start) >= (rtcnt_t)us * POLL_CYCLES_PER_US; }
+#        endif
+#    endif
+
+typedef struct {
+    uint8_t     port;   // index into ports[]
+    uint8_t     pad;    // pad of the first line
+    uint8_t     index;  // bit of the first line in the result
+    uint8_t     width;
+    port_data_t mask;
+} port_scan_run_t;
+
+static pin_t           ports[MATRIX_COLS];
+static uint8_t         port_count;
+static port_scan_run_t runs[MATRIX_COLS];
+static uint8_t         run_count;
+
+void matrix_port_scan_init(const pin_t pins[], uint8_t count) {
+    port_count = 0;
+    run_count  = 0;
+
+    for (uint8_t i = 0; i < count && i < MATRIX_COLS; i++) {
+        if (pins[i] == NO_PIN) {
+            continue;
+        }
+        pin_t   port = getPinPort(pins[i]);
+        uint8_t pad  = getPinPad(pins[i]);
+        uint8_t p    = 0;
+        while (p < port_count && ports[p] != port) {
+            p++;
+        }
+        if (p == port_count) {
+            ports[port_count++] = port;
+        }
+
+        // Extend the previous run if this line is on the next pad of the same port
+        if (run_count) {
+            port_scan_run_t *run = &runs[run_count - 1];
+            if (run->port == p && run->index + run->width == i && run->pad + run->width == pad) {
+                run->width++;
+                continue;
+            }
+        }
+        runs[run_count++] = (port_scan_run_t){.port = p, .pad = pad, .index = i, .width = 1};
+    }
+
+    for (uint8_t r = 0; r < run_count; r++) {
+        runs[r].mask = ((port_data_t)1 << runs[r].width) - 1;
+    }
+}
+
+matrix_row_t matrix_port_scan_read(void) {
+    port_data_t  values[MATRIX_COLS];
+    matrix_row_t result = 0;
+
+    for (uint8_t p = 0; p < port_count; p++) {
+        // Lines are active low
+        values[p] = ~readPort(ports[p]);
+    }
+    for (uint8_t r = 0; r < run_count; r++) {
+        const port_scan_run_t *run = &runs[r];
+        result |= (matrix_row_t)((values[run->port] >> run->pad) & run->mask) << run->index;
+    }
+    return result;
+}
+
+#    if defined(POLL_DEADLINE)
+// Reads back to back are only a few cycles apart, so the value has to hold for 1us
+matrix_row_t matrix_port_scan_read_stable(void) {
+    rtcnt_t      start  = poll_start();
+    rtcnt_t      stable = start;
+    matrix_row_t value  = matrix_port_scan_read();
+    while (!poll_elapsed(stable, 1) && !poll_elapsed(start, MATRIX_IO_DELAY)) {
+        matrix_row_t next = matrix_port_scan_read();
+        if (next != value) {
+            value  = next;
+            stable = poll_start();
+        }
+    }
+    return value;
+}
+
+void matrix_port_scan_wait_idle(void) {
+    rtcnt_t start = poll_start();
+    while (matrix_port_scan_read() && !poll_elapsed(start, MATRIX_IO_DELAY)) {
+    }
+}
+#    elif defined(POLL_US_STEPS)
+matrix_row_t matrix_port_scan_read_stable(void) {
+    matrix_row_t value = matrix_port_scan_read();
+    for (uint16_t i = 0; i < MATRIX_IO_DELAY; i++) {
+        wait_us(1);
+        matrix_row_t next = matrix_port_scan_read();
+        if (next == value) {
+            break;
+        }
+        value = next;
+    }
+    return value;
+}
+
+void matrix_port_scan_wait_idle(void) {
+    for (uint16_t i = 0; i < MATRIX_IO_DELAY && matrix_port_scan_read(); i++) {
+        wait_us(1);
+    }
+}
+#    else
+// No fine clock, so wait the fixed delay like the pin by pin scan does
+matrix_row_t matrix_port_scan_read_stable(void) {
+    matrix_io_delay();
+    return matrix_port_scan_read();
+}
+
+void matrix_port_scan_wait_idle(void) {
+    if (matrix_port_scan_read()) {
+        matrix_io_delay();
+    }
+}
+#    endif
+
+#endif
@@ -0,0 +1,41 @@
+/* Copyright 2020 QMK
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "matrix.h"
+#include "quantum.h"
+
+/* Reads matrix lines a GPIO port at a time
+ *
+ * Enable with #define MATRIX_PORT_SCAN in config.h. The pins are grouped by
+ * port once at startup, and lines on consecutive pads of the same port are
+ * read as one run with a shift and a mask, so a row costs one register read
+ * per port used instead of one per column.
+ */
+
+void matrix_port_scan_init(const pin_t pins[], uint8_t count);
+
+/* Lines that read low, bit n is pins[n] */
+matrix_row_t matrix_port_scan_read(void);
+
+/* Reads the lines once they have stopped changing, at most MATRIX_IO_DELAY us.
+ * Falls back to matrix_io_delay() where there is no clock to poll against. */
+matrix_row_t matrix_port_scan_read_stable(void);
+
+/* Waits for every line to be pulled high again, at most MATRIX_IO_DELAY us */
+void matrix_port_scan_wait_idle(void);
@@ -22,6 +22,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "print.h"
 #include "debug.h"
 #include "pointing_device.h"
+#include "matrix.h"
 
 static report_mouse_t mouseReport = {};
 
@@ -36,6 +37,9 @@ __attribute__((weak)) void pointing_device_send(void) {
 
     // If you need to do other things, like debugging, this is the place to do it.
     if (has_mouse_report_changed(mouseReport, old_report)) {
+#ifdef MATRIX_IDLE_TIMEOUT
+        matrix_idle_activity();
+#endif
         host_mouse_send(&mouseReport);
     }
     // send it and 0 it out except for buttons, so those stay until they are explicity over-ridden using update_pointing_device
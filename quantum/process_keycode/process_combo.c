@@ -16,6 +16,9 @@
 
 #include "print.h"
 #include "process_combo.h"
+#ifdef DEFERRED_EXEC_ENABLE
+#    include "deferred_exec.h"
+#endif
 
 #ifndef COMBO_VARIABLE_LEN
 __attribute__((weak)) combo_t key_combos[COMBO_COUNT] = {};
@@ -32,6 +35,12 @@ static bool     drop_buffer         = false;
 static bool     is_active           = false;
 static bool     b_combo_enable      = true;  // defaults to enabled
 
+static uint16_t combos_with_keys_down = 0;
+
+#ifdef DEFERRED_EXEC_ENABLE
+static deferred_token timeout_token = INVALID_DEFERRED_TOKEN;
+#endif
+
 static uint8_t buffer_size = 0;
 #ifdef COMBO_ALLOW_ACTION_KEYS
 static keyrecord_t key_buffer[MAX_COMBO_LENGTH];
@@ -39,6 +48,26 @@ static keyrecord_t key_buffer[MAX_COMBO_LENGTH];
 static uint16_t key_buffer[MAX_COMBO_LENGTH];
 #endif
 
+static void check_timeout(void);
+
+#ifdef DEFERRED_EXEC_ENABLE
+static uint32_t timeout_callback(uint32_t trigger_time, void *cb_arg) {
+    timeout_token = INVALID_DEFERRED_TOKEN;
+    check_timeout();
+    return 0;
+}
+#endif
+
+static void start_timer(void) {
+    timer = timer_read();
+#ifdef DEFERRED_EXEC_ENABLE
+    // Check once the timer has run for more than COMBO_TERM
+    if (!extend_deferred_exec(timeout_token, COMBO_TERM + 1)) {
+        timeout_token = defer_exec(COMBO_TERM + 1, timeout_callback, NULL);
+    }
+#endif
+}
+
 static inline void send_combo(uint16_t action, bool pressed) {
     if (action) {
         if (pressed) {
@@ -71,14 +100,18 @@ static inline void dump_key_buffer(bool emit) {
     buffer_size = 0;
 }
 
-#define ALL_COMBO_KEYS_ARE_DOWN (((1 << count) - 1) == combo->state)
-#define KEY_STATE_DOWN(key)         \
-    do {                            \
-        combo->state |= (1 << key); \
+#define ALL_COMBO_KEYS_ARE_DOWN ((combo_state_t)((combo_state_t)~(combo_state_t)0 >> (sizeof(combo_state_t) * 8 - count)) == combo->state)
+#define KEY_STATE_DOWN(key)                         \
+    do {                                            \
+        if (!combo->state) combos_with_keys_down++; \
+        combo->state |= (combo_state_t)1 << key;    \
     } while (0)
-#define KEY_STATE_UP(key)            \
-    do {                             \
-        combo->state &= ~(1 << key); \
+#define KEY_STATE_UP(key)                               \
+    do {                                                \
+        if (combo->state & ((combo_state_t)1 << key)) { \
+            combo->state &= ~((combo_state_t)1 << key); \
+            if (!combo->state) combos_with_keys_down--; \
+        }                                               \
     } while (0)
 
 static bool process_single_combo(combo_t *combo, uint16_t keycode, keyrecord_t *record) {
@@ -92,7 +125,7 @@ static bool process_single_combo(combo_t *combo, uint16_t keycode, keyrecord_t *
     }
 
     /* Continue processing if not a combo key */
-    if (-1 == (int8_t)index) return false;
+    if (-1 == (int8_t)index || count > MAX_COMBO_LENGTH) return false;
 
     bool is_combo_active = is_active;
 
@@ -119,12 +152,75 @@ static bool process_single_combo(combo_t *combo, uint16_t keycode, keyrecord_t *
     return is_combo_active;
 }
 
-#define NO_COMBO_KEYS_ARE_DOWN (0 == combo->state)
+#ifdef COMBO_INDEX_SIZE
+/* Index from keycodes to the combos they are part of
+ *
+ * Sorted by keycode, then by combo, so the combos containing a keycode can be
+ * found with a binary search and are processed in the same order as without
+ * the index. It is built on first use, and if the combos have more keys than
+ * fit into it, every combo is checked as before.
+ */
+typedef struct {
+    uint16_t keycode;
+    uint16_t combo_index;
+} combo_index_entry_t;
+
+static combo_index_entry_t combo_index[COMBO_INDEX_SIZE];
+static uint16_t            combo_index_length = 0;
+static enum { COMBO_INDEX_UNBUILT, COMBO_INDEX_BUILT, COMBO_INDEX_OVERFLOW } combo_index_state = COMBO_INDEX_UNBUILT;
+
+static void combo_index_build(void) {
+    combo_index_length = 0;
+    combo_index_state  = COMBO_INDEX_BUILT;
+#    ifndef COMBO_VARIABLE_LEN
+    for (uint16_t i = 0; i < COMBO_COUNT; i++) {
+#    else
+    for (uint16_t i = 0; i < COMBO_LEN; i++) {
+#    endif
+        for (const uint16_t *keys = key_combos[i].keys;; keys++) {
+            uint16_t key = pgm_read_word(keys);
+            if (COMBO_END == key) break;
+            if (combo_index_length >= COMBO_INDEX_SIZE) {
+                combo_index_state = COMBO_INDEX_OVERFLOW;
+                return;
+            }
+            /* Insertion sort, combos are visited in order so ties go at the end */
+            uint16_t pos = combo_index_length;
+            while (pos > 0 && combo_index[pos - 1].keycode > key) {
+                combo_index[pos] = combo_index[pos - 1];
+                pos--;
+            }
+            /* A keycode listed twice in the same combo is only indexed once */
+            if (pos > 0 && combo_index[pos - 1].keycode == key && combo_index[pos - 1].combo_index == i) {
+                for (; pos < combo_index_length; pos++) {
+                    combo_index[pos] = combo_index[pos + 1];
+                }
+                continue;
+            }
+            combo_index[pos] = (combo_index_entry_t){.keycode = key, .combo_index = i};
+            combo_index_length++;
+        }
+    }
+}
+
+/* Returns the first entry for the keycode, or combo_index_length if there is none */
+static uint16_t combo_index_find(uint16_t keycode) {
+    uint16_t low = 0, high = combo_index_length;
+    while (low < high) {
+        uint16_t mid = low + (high - low) / 2;
+        if (combo_index[mid].keycode < keycode) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+#endif
 
 bool process_combo(uint16_t keycode, keyrecord_t *record) {
-    bool is_combo_key          = false;
-    drop_buffer                = false;
-    bool no_combo_keys_pressed = true;
+    bool is_combo_key = false;
+    drop_buffer       = false;
 
     if (keycode == CMB_ON && record->event.pressed) {
         combo_enable();
@@ -144,33 +240,45 @@ bool process_combo(uint16_t keycode, keyrecord_t *record) {
     if (!is_combo_enabled()) {
         return true;
     }
+#ifdef COMBO_INDEX_SIZE
+    if (combo_index_state == COMBO_INDEX_UNBUILT) {
+        combo_index_build();
+    }
+    if (combo_index_state == COMBO_INDEX_BUILT) {
+        for (uint16_t i = combo_index_find(keycode); i < combo_index_length && combo_index[i].keycode == keycode; i++) {
+            current_combo_index = combo_index[i].combo_index;
+            is_combo_key |= process_single_combo(&key_combos[current_combo_index], keycode, record);
+        }
+    } else
+#endif
+    {
 #ifndef COMBO_VARIABLE_LEN
-    for (current_combo_index = 0; current_combo_index < COMBO_COUNT; ++current_combo_index) {
+        for (current_combo_index = 0; current_combo_index < COMBO_COUNT; ++current_combo_index) {
 #else
-    for (current_combo_index = 0; current_combo_index < COMBO_LEN; ++current_combo_index) {
+        for (current_combo_index = 0; current_combo_index < COMBO_LEN; ++current_combo_index) {
 #endif
-        combo_t *combo = &key_combos[current_combo_index];
-        is_combo_key |= process_single_combo(combo, keycode, record);
-        no_combo_keys_pressed = no_combo_keys_pressed && NO_COMBO_KEYS_ARE_DOWN;
+            combo_t *combo = &key_combos[current_combo_index];
+            is_combo_key |= process_single_combo(combo, keycode, record);
+        }
     }
 
     if (drop_buffer) {
         /* buffer is only dropped when we complete a combo, so we refresh the timer
          * here */
-        timer = timer_read();
+        start_timer();
         dump_key_buffer(false);
     } else if (!is_combo_key) {
         /* if no combos claim the key we need to emit the keybuffer */
         dump_key_buffer(true);
 
         // reset state if there are no combo keys pressed at all
-        if (no_combo_keys_pressed) {
+        if (combos_with_keys_down == 0) {
             timer     = 0;
             is_active = true;
         }
     } else if (record->event.pressed && is_active) {
         /* otherwise the key is consumed and placed in the buffer */
-        timer = timer_read();
+        start_timer();
 
         if (buffer_size < MAX_COMBO_LENGTH) {
 #ifdef COMBO_ALLOW_ACTION_KEYS
@@ -184,7 +292,7 @@ bool process_combo(uint16_t keycode, keyrecord_t *record) {
     return !is_combo_key;
 }
 
-void matrix_scan_combo(void) {
+static void check_timeout(void) {
     if (b_combo_enable && is_active && timer && timer_elapsed(timer) > COMBO_TERM) {
         /* This disables the combo, meaning key events for this
          * combo will be handled by the next processors in the chain
@@ -194,6 +302,16 @@ void matrix_scan_combo(void) {
     }
 }
 
+void matrix_scan_combo(void) {
+#ifdef DEFERRED_EXEC_ENABLE
+    // Only poll when there was no free deferred slot
+    if (timeout_token != INVALID_DEFERRED_TOKEN) {
+        return;
+    }
+#endif
+    check_timeout();
+}
+
 void combo_enable(void) { b_combo_enable = true; }
 
 void combo_disable(void) {
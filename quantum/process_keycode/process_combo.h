@@ -28,16 +28,18 @@
 #    define MAX_COMBO_LENGTH 8
 #endif
 
-typedef struct {
-    const uint16_t *keys;
-    uint16_t        keycode;
 #ifdef EXTRA_EXTRA_LONG_COMBOS
-    uint32_t state;
+typedef uint32_t combo_state_t;
 #elif EXTRA_LONG_COMBOS
-    uint16_t state;
+typedef uint16_t combo_state_t;
 #else
-    uint8_t state;
+typedef uint8_t combo_state_t;
 #endif
+
+typedef struct {
+    const uint16_t *keys;
+    uint16_t        keycode;
+    combo_state_t   state;
 } combo_t;
 
 #define COMBO(ck, ca) \
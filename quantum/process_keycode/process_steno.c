@@ -84,13 +84,16 @@ void steno_init() {
     if (!eeconfig_is_enabled()) {
         eeconfig_init();
     }
-    mode = eeprom_read_byte(EECONFIG_STENOMODE);
+    uint8_t val;
+    eeconfig_read_block(&val, EECONFIG_STENOMODE, sizeof(val));
+    mode = val;
 }
 
 void steno_set_mode(steno_mode_t new_mode) {
     steno_clear_state();
     mode = new_mode;
-    eeprom_update_byte(EECONFIG_STENOMODE, mode);
+    uint8_t val = mode;
+    eeconfig_update_block(&val, EECONFIG_STENOMODE, sizeof(val));
 }
 
 /* override to intercept chords right before they get sent.
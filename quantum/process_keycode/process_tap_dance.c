@@ -13,7 +13,11 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <string.h>
 #include "quantum.h"
+#ifdef DEFERRED_EXEC_ENABLE
+#    include "deferred_exec.h"
+#endif
 
 #ifndef NO_ACTION_ONESHOT
 uint8_t get_oneshot_mods(void);
@@ -22,6 +26,22 @@ uint8_t get_oneshot_mods(void);
 static uint16_t last_td;
 static int8_t   highest_td = -1;
 
+/* Dances in flight, in the order they started, so only those are checked on
+ * every scan and key press. Their tapping term is looked up once per tap.
+ */
+typedef struct {
+    uint8_t  index;
+    uint16_t tapping_term;
+#ifdef DEFERRED_EXEC_ENABLE
+    deferred_token token;
+#endif
+} active_tap_dance_t;
+
+static active_tap_dance_t active_tds[TAP_DANCE_MAX_ACTIVE];
+static uint8_t            active_count = 0;
+// Set when a dance didn't fit, then all dances up to highest_td are checked until none is in flight
+static bool active_overflow = false;
+
 void qk_tap_dance_pair_on_each_tap(qk_tap_dance_state_t *state, void *user_data) {
     qk_tap_dance_pair_t *pair = (qk_tap_dance_pair_t *)user_data;
 
@@ -102,21 +122,114 @@ static inline void process_tap_dance_action_on_reset(qk_tap_dance_action_t *acti
     send_keyboard_report();
 }
 
-void preprocess_tap_dance(uint16_t keycode, keyrecord_t *record) {
-    qk_tap_dance_action_t *action;
+static uint16_t get_tap_dance_term(qk_tap_dance_action_t *action) {
+    if (action->custom_tapping_term > 0) {
+        return action->custom_tapping_term;
+    }
+#ifdef TAPPING_TERM_PER_KEY
+    return get_tapping_term(action->state.keycode, NULL);
+#else
+    return TAPPING_TERM;
+#endif
+}
+
+static active_tap_dance_t *find_active(uint8_t index) {
+    for (uint8_t i = 0; i < active_count; i++) {
+        if (active_tds[i].index == index) {
+            return &active_tds[i];
+        }
+    }
+    return NULL;
+}
+
+static void remove_active(uint8_t index) {
+    for (uint8_t i = 0; i < active_count; i++) {
+        if (active_tds[i].index == index) {
+#ifdef DEFERRED_EXEC_ENABLE
+            cancel_deferred_exec(active_tds[i].token);
+#endif
+            active_count--;
+            memmove(&active_tds[i], &active_tds[i + 1], (active_count - i) * sizeof(active_tap_dance_t));
+            return;
+        }
+    }
+}
+
+/* Copies the indices of the dances in flight, so the list can change while they are processed */
+static uint8_t get_active(uint8_t indices[]) {
+    for (uint8_t i = 0; i < active_count; i++) {
+        indices[i] = active_tds[i].index;
+    }
+    return active_count;
+}
+
+static void check_timeout(uint8_t index, uint16_t tapping_term) {
+    qk_tap_dance_action_t *action = &tap_dance_actions[index];
+    if (action->state.count && timer_elapsed(action->state.timer) > tapping_term) {
+        process_tap_dance_action_on_dance_finished(action);
+        reset_tap_dance(&action->state);
+    }
+}
 
+#ifdef DEFERRED_EXEC_ENABLE
+static uint32_t timeout_callback(uint32_t trigger_time, void *cb_arg) {
+    uint8_t             index  = (uintptr_t)cb_arg;
+    active_tap_dance_t *active = find_active(index);
+    if (active) {
+        // If the key is still held, matrix_scan_tap_dance() takes over until it's released
+        active->token = INVALID_DEFERRED_TOKEN;
+        check_timeout(index, active->tapping_term);
+    }
+    return 0;
+}
+#endif
+
+static void track_tap_dance(uint8_t index, qk_tap_dance_action_t *action) {
+    active_tap_dance_t *active = find_active(index);
+    if (!active) {
+        if (active_count == TAP_DANCE_MAX_ACTIVE) {
+            active_overflow = true;
+            return;
+        }
+        active        = &active_tds[active_count++];
+        active->index = index;
+#ifdef DEFERRED_EXEC_ENABLE
+        active->token = INVALID_DEFERRED_TOKEN;
+#endif
+    }
+    active->tapping_term = get_tap_dance_term(action);
+#ifdef DEFERRED_EXEC_ENABLE
+    // Check once the timer has run for more than the tapping term
+    if (!extend_deferred_exec(active->token, active->tapping_term + 1)) {
+        active->token = defer_exec(active->tapping_term + 1, timeout_callback, (void *)(uintptr_t)index);
+    }
+#endif
+}
+
+static void interrupt_tap_dance(qk_tap_dance_action_t *action, uint16_t keycode) {
+    if (action->state.count) {
+        if (keycode == action->state.keycode && keycode == last_td) return;
+        action->state.interrupted          = true;
+        action->state.interrupting_keycode = keycode;
+        process_tap_dance_action_on_dance_finished(action);
+        reset_tap_dance(&action->state);
+    }
+}
+
+void preprocess_tap_dance(uint16_t keycode, keyrecord_t *record) {
     if (!record->event.pressed) return;
 
     if (highest_td == -1) return;
 
-    for (int i = 0; i <= highest_td; i++) {
-        action = &tap_dance_actions[i];
-        if (action->state.count) {
-            if (keycode == action->state.keycode && keycode == last_td) continue;
-            action->state.interrupted          = true;
-            action->state.interrupting_keycode = keycode;
-            process_tap_dance_action_on_dance_finished(action);
-            reset_tap_dance(&action->state);
+    if (active_overflow) {
+        for (int i = 0; i <= highest_td; i++) {
+            interrupt_tap_dance(&tap_dance_actions[i], keycode);
+        }
+    } else {
+        uint8_t indices[TAP_DANCE_MAX_ACTIVE];
+        uint8_t count = get_active(indices);
+        for (uint8_t i = 0; i < count; i++) {
+            interrupt_tap_dance(&tap_dance_actions[indices[i]], keycode);
         }
     }
 }
@@ -143,6 +256,7 @@ bool process_tap_dance(uint16_t keycode, keyrecord_t *record) {
                 action->state.weak_mods = get_mods();
                 action->state.weak_mods |= get_weak_mods();
                 process_tap_dance_action_on_each_tap(action);
+                track_tap_dance(idx, action);
 
                 last_td = keycode;
             } else {
@@ -159,23 +273,37 @@ bool process_tap_dance(uint16_t keycode, keyrecord_t *record) {
 
 void matrix_scan_tap_dance() {
     if (highest_td == -1) return;
-    uint16_t tap_user_defined;
 
-    for (uint8_t i = 0; i <= highest_td; i++) {
-        qk_tap_dance_action_t *action = &tap_dance_actions[i];
-        if (action->custom_tapping_term > 0) {
-            tap_user_defined = action->custom_tapping_term;
-        } else {
-#ifdef TAPPING_TERM_PER_KEY
-            tap_user_defined = get_tapping_term(action->state.keycode, NULL);
-#else
-            tap_user_defined = TAPPING_TERM;
-#endif
+    if (active_overflow) {
+        bool in_flight = false;
+        for (uint8_t i = 0; i <= highest_td; i++) {
+            check_timeout(i, get_tap_dance_term(&tap_dance_actions[i]));
+            in_flight |= tap_dance_actions[i].state.count != 0;
         }
-        if (action->state.count && timer_elapsed(action->state.timer) > tap_user_defined) {
-            process_tap_dance_action_on_dance_finished(action);
-            reset_tap_dance(&action->state);
+        if (!in_flight) {
+            while (active_count) {
+                remove_active(active_tds[0].index);
+            }
+            active_overflow = false;
         }
+        return;
+    }
+
+    uint8_t indices[TAP_DANCE_MAX_ACTIVE];
+    uint8_t count = get_active(indices);
+    for (uint8_t i = 0; i < count; i++) {
+        active_tap_dance_t *active = find_active(indices[i]);
+        if (active && !tap_dance_actions[indices[i]].state.count) {
+            // Reset without going through reset_tap_dance()
+            remove_active(indices[i]);
+            continue;
+        }
+#ifdef DEFERRED_EXEC_ENABLE
+        if (!active || active->token != INVALID_DEFERRED_TOKEN) continue;
+#else
+        if (!active) continue;
+#endif
+        check_timeout(indices[i], active->tapping_term);
     }
 }
 
@@ -193,4 +321,6 @@ void reset_tap_dance(qk_tap_dance_state_t *state) {
     state->finished             = false;
     state->interrupting_keycode = 0;
     last_td                     = 0;
+
+    remove_active(state->keycode - QK_TAP_DANCE);
 }
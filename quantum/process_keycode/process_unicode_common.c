@@ -30,7 +30,9 @@ static int8_t  selected_index;
 #endif
 
 void unicode_input_mode_init(void) {
-    unicode_config.raw = eeprom_read_byte(EECONFIG_UNICODEMODE);
+    uint8_t input_mode;
+    eeconfig_read_block(&input_mode, EECONFIG_UNICODEMODE, sizeof(input_mode));
+    unicode_config.raw = input_mode;
 #if UNICODE_SELECTED_MODES != -1
 #    if UNICODE_CYCLE_PERSIST
     // Find input_mode in selected modes
@@ -75,7 +77,10 @@ void cycle_unicode_input_mode(int8_t offset) {
 #endif
 }
 
-void persist_unicode_input_mode(void) { eeprom_update_byte(EECONFIG_UNICODEMODE, unicode_config.input_mode); }
+void persist_unicode_input_mode(void) {
+    uint8_t input_mode = unicode_config.input_mode;
+    eeconfig_update_block(&input_mode, EECONFIG_UNICODEMODE, sizeof(input_mode));
+}
 
 __attribute__((weak)) void unicode_input_start(void) {
     unicode_saved_caps_lock = host_keyboard_led_state().caps_lock;
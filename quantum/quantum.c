@@ -16,6 +16,7 @@
 
 #include <ctype.h>
 #include "quantum.h"
+#include "scan_profile.h"
 
 #ifdef BLUETOOTH_ENABLE
 #    include "outputselect.h"
@@ -144,6 +145,10 @@ void reset_keyboard(void) {
 #ifdef HAPTIC_ENABLE
     haptic_shutdown();
 #endif
+#ifdef DYNAMIC_KEYMAP_ENABLE
+    dynamic_keymap_flush();
+#endif
+    eeconfig_flush();
     bootloader_jump();
 }
 
@@ -434,6 +439,250 @@ __attribute__((weak)) const uint8_t ascii_to_keycode_lut[128] PROGMEM = {
 // Note: we bit-pack in "reverse" order to optimize loading
 #define PGM_LOADBIT(mem, pos) ((pgm_read_byte(&((mem)[(pos) / 8])) >> ((pos) % 8)) & 0x01)
 
+#ifdef SEND_STRING_ASYNC
+#    ifndef SEND_STRING_QUEUE_SIZE
+#        define SEND_STRING_QUEUE_SIZE 64
+#    endif
+#    ifndef SEND_STRING_CHARS_PER_TASK
+#        define SEND_STRING_CHARS_PER_TASK 1
+#    endif
+
+// Queue entry that hands over to a string that stays valid until it has been
+// typed, followed by its send_string_source_t
+#    define SEND_STRING_SOURCE_CODE 0
+
+typedef struct {
+    const char *       str;
+    send_string_read_t read;
+    uint8_t            interval;
+    bool               bare_codes;
+} send_string_source_t;
+
+_Static_assert(SEND_STRING_QUEUE_SIZE > sizeof(send_string_source_t), "SEND_STRING_QUEUE_SIZE is too small to hold a string");
+
+// send_string() output waiting to be typed by send_string_task(). Every entry
+// is either a character, or one of the SS_*_CODE bytes followed by a keycode,
+// or by a delay in milliseconds (big endian), or SEND_STRING_SOURCE_CODE.
+static uint8_t  send_string_queue[SEND_STRING_QUEUE_SIZE];
+static uint16_t send_string_head  = 0;
+static uint16_t send_string_count = 0;
+static uint32_t send_string_delay = 0;
+static uint32_t send_string_delay_timer;
+
+// The string being typed, read is NULL if there is none
+static send_string_source_t send_string_source = {.read = NULL};
+
+static uint8_t send_string_pop(void) {
+    uint8_t data     = send_string_queue[send_string_head];
+    send_string_head = (send_string_head + 1) % SEND_STRING_QUEUE_SIZE;
+    send_string_count--;
+    return data;
+}
+
+static void send_string_push(uint8_t data) {
+    send_string_queue[(send_string_head + send_string_count) % SEND_STRING_QUEUE_SIZE] = data;
+    send_string_count++;
+}
+
+static bool send_string_pending(void) { return send_string_count || send_string_source.read; }
+
+static bool send_string_delaying(void) {
+    if (send_string_delay && timer_elapsed32(send_string_delay_timer) < send_string_delay) {
+        return true;
+    }
+    send_string_delay = 0;
+    return false;
+}
+
+static void send_string_start_delay(uint32_t ms) {
+    send_string_delay       = ms;
+    send_string_delay_timer = timer_read32();
+}
+
+static uint8_t send_string_source_next(void) { return send_string_source.read(++send_string_source.str); }
+
+// Types the next character or keycode of the current string, and starts the
+// delay that follows it
+static void send_string_type_source(void) {
+    uint8_t  code    = send_string_source.read(send_string_source.str);
+    uint32_t ms      = send_string_source.interval;
+    bool     is_code = send_string_source.bare_codes ? (code >= SS_TAP_CODE && code <= SS_UP_CODE) : code == SS_QMK_PREFIX;
+    if (!is_code) {
+        send_char(code);
+    } else {
+        if (!send_string_source.bare_codes) {
+            code = send_string_source_next();
+        }
+        switch (code) {
+            case SS_TAP_CODE:
+                tap_code(send_string_source_next());
+                break;
+            case SS_DOWN_CODE:
+                register_code(send_string_source_next());
+                break;
+            case SS_UP_CODE:
+                unregister_code(send_string_source_next());
+                break;
+            case SS_DELAY_CODE: {
+                uint32_t delay = 0;
+                uint8_t  digit = send_string_source_next();
+                while (isdigit(digit)) {
+                    delay *= 10;
+                    delay += digit - '0';
+                    digit = send_string_source_next();
+                }
+                ms += delay;
+                break;
+            }
+        }
+    }
+    // Stop at the terminator, also when it cut a code short
+    if (!send_string_source.read(send_string_source.str) || !send_string_source_next()) {
+        send_string_source.read = NULL;
+    }
+    if (ms) {
+        send_string_start_delay(ms);
+    }
+}
+
+// Types the next entry of the queue
+static void send_string_type_entry(void) {
+    if (!send_string_source.read) {
+        uint8_t code = send_string_pop();
+        switch (code) {
+            case SEND_STRING_SOURCE_CODE:
+                for (uint8_t i = 0; i < sizeof(send_string_source); i++) {
+                    ((uint8_t *)&send_string_source)[i] = send_string_pop();
+                }
+                break;
+            case SS_TAP_CODE:
+                tap_code(send_string_pop());
+                return;
+            case SS_DOWN_CODE:
+                register_code(send_string_pop());
+                return;
+            case SS_UP_CODE:
+                unregister_code(send_string_pop());
+                return;
+            case SS_DELAY_CODE: {
+                uint16_t ms = send_string_pop() << 8;
+                ms |= send_string_pop();
+                send_string_start_delay(ms);
+                return;
+            }
+            default:
+                send_char(code);
+                return;
+        }
+    }
+    send_string_type_source();
+}
+
+// Types the next entry right away, waiting out a delay if there is one
+static void send_string_type_entry_now(void) {
+    while (send_string_delaying()) {
+        wait_ms(1);
+    }
+    if (send_string_pending()) {
+        send_string_type_entry();
+    }
+}
+
+// Makes room for length bytes, by typing the oldest entries if the queue is full
+static void send_string_reserve(uint8_t length) {
+    while (SEND_STRING_QUEUE_SIZE - send_string_count < length) {
+        send_string_type_entry_now();
+    }
+}
+
+static void send_string_queue_entry(uint8_t code, uint16_t data) {
+    uint8_t length = code == SS_DELAY_CODE ? 3 : code <= SS_UP_CODE ? 2 : 1;
+    send_string_reserve(length);
+    send_string_push(code);
+    if (code == SS_DELAY_CODE) {
+        send_string_push(data >> 8);
+        send_string_push(data & 0xFF);
+    } else if (length == 2) {
+        send_string_push(data);
+    }
+}
+
+/** \brief Types a string in the background, reading it a byte at a time
+ *
+ * Unlike send_string(), the string isn't copied into the queue, so it has to
+ * stay valid until it has been typed. With bare_codes, SS_TAP_CODE,
+ * SS_DOWN_CODE and SS_UP_CODE aren't preceded by SS_QMK_PREFIX, as in dynamic
+ * keymap macros.
+ */
+void send_string_from(const char *str, uint8_t interval, send_string_read_t read, bool bare_codes) {
+    if (!read(str)) {
+        return;
+    }
+    send_string_source_t source = {.str = str, .read = read, .interval = interval, .bare_codes = bare_codes};
+    send_string_reserve(1 + sizeof(source));
+    send_string_push(SEND_STRING_SOURCE_CODE);
+    for (uint8_t i = 0; i < sizeof(source); i++) {
+        send_string_push(((uint8_t *)&source)[i]);
+    }
+}
+
+static uint8_t send_string_read_P(const char *str) { return pgm_read_byte(str); }
+
+/** \brief Types some of the queued send_string() output
+ *
+ * Called every scan, types at most SEND_STRING_CHARS_PER_TASK characters or
+ * keycodes unless a delay is running.
+ */
+void send_string_task(void) {
+    for (uint8_t i = 0; i < SEND_STRING_CHARS_PER_TASK && send_string_pending(); i++) {
+        if (send_string_delaying()) {
+            return;
+        }
+        send_string_type_entry();
+    }
+}
+
+/** \brief Types all of the queued send_string() output before returning
+ */
+void send_string_flush(void) {
+    while (send_string_pending() || send_string_delay) {
+        send_string_type_entry_now();
+    }
+}
+
+static void send_string_tap(uint8_t keycode) { send_string_queue_entry(SS_TAP_CODE, keycode); }
+
+static void send_string_down(uint8_t keycode) { send_string_queue_entry(SS_DOWN_CODE, keycode); }
+
+static void send_string_up(uint8_t keycode) { send_string_queue_entry(SS_UP_CODE, keycode); }
+
+static void send_string_wait(uint32_t ms) {
+    while (ms > UINT16_MAX) {
+        send_string_queue_entry(SS_DELAY_CODE, UINT16_MAX);
+        ms -= UINT16_MAX;
+    }
+    if (ms) {
+        send_string_queue_entry(SS_DELAY_CODE, ms);
+    }
+}
+
+static void send_string_char(char ascii_code) {
+    // The SS_*_CODE values are control characters that don't type anything
+    if ((uint8_t)ascii_code > SS_DELAY_CODE) {
+        send_string_queue_entry(ascii_code, 0);
+    }
+}
+#else
+#    define send_string_tap(keycode) tap_code(keycode)
+#    define send_string_down(keycode) register_code(keycode)
+#    define send_string_up(keycode) unregister_code(keycode)
+#    define send_string_char(ascii_code) send_char(ascii_code)
+
+static void send_string_wait(uint32_t ms) {
+    while (ms--) wait_ms(1);
+}
+#endif
+
 void send_string(const char *str) { send_string_with_delay(str, 0); }
 
 void send_string_P(const char *str) { send_string_with_delay_P(str, 0); }
@@ -447,15 +696,15 @@ void send_string_with_delay(const char *str, uint8_t interval) {
             if (ascii_code == SS_TAP_CODE) {
                 // tap
                 uint8_t keycode = *(++str);
-                tap_code(keycode);
+                send_string_tap(keycode);
             } else if (ascii_code == SS_DOWN_CODE) {
                 // down
                 uint8_t keycode = *(++str);
-                register_code(keycode);
+                send_string_down(keycode);
             } else if (ascii_code == SS_UP_CODE) {
                 // up
                 uint8_t keycode = *(++str);
-                unregister_code(keycode);
+                send_string_up(keycode);
             } else if (ascii_code == SS_DELAY_CODE) {
                 // delay
                 int     ms      = 0;
@@ -465,21 +714,22 @@ void send_string_with_delay(const char *str, uint8_t interval) {
                     ms += keycode - '0';
                     keycode = *(++str);
                 }
-                while (ms--) wait_ms(1);
+                send_string_wait(ms);
             }
         } else {
-            send_char(ascii_code);
+            send_string_char(ascii_code);
         }
         ++str;
         // interval
-        {
-            uint8_t ms = interval;
-            while (ms--) wait_ms(1);
-        }
+        send_string_wait(interval);
     }
 }
 
 void send_string_with_delay_P(const char *str, uint8_t interval) {
+#ifdef SEND_STRING_ASYNC
+    // Strings in PROGMEM don't go away, so they are read while being typed
+    send_string_from(str, interval, send_string_read_P, false);
+#else
     while (1) {
         char ascii_code = pgm_read_byte(str);
         if (!ascii_code) break;
@@ -488,15 +738,15 @@ void send_string_with_delay_P(const char *str, uint8_t interval) {
             if (ascii_code == SS_TAP_CODE) {
                 // tap
                 uint8_t keycode = pgm_read_byte(++str);
-                tap_code(keycode);
+                send_string_tap(keycode);
             } else if (ascii_code == SS_DOWN_CODE) {
                 // down
                 uint8_t keycode = pgm_read_byte(++str);
-                register_code(keycode);
+                send_string_down(keycode);
             } else if (ascii_code == SS_UP_CODE) {
                 // up
                 uint8_t keycode = pgm_read_byte(++str);
-                unregister_code(keycode);
+                send_string_up(keycode);
             } else if (ascii_code == SS_DELAY_CODE) {
                 // delay
                 int     ms      = 0;
@@ -506,18 +756,16 @@ void send_string_with_delay_P(const char *str, uint8_t interval) {
                     ms += keycode - '0';
                     keycode = pgm_read_byte(++str);
                 }
-                while (ms--) wait_ms(1);
+                send_string_wait(ms);
             }
         } else {
-            send_char(ascii_code);
+            send_string_char(ascii_code);
         }
         ++str;
         // interval
-        {
-            uint8_t ms = interval;
-            while (ms--) wait_ms(1);
-        }
+        send_string_wait(interval);
     }
+#endif
 }
 
 void send_char(char ascii_code) {
@@ -650,7 +898,9 @@ void matrix_scan_quantum() {
 #endif
 
 #ifdef RGB_MATRIX_ENABLE
+    SCAN_PROFILE_BEGIN(PROFILE_RGB_MATRIX);
     rgb_matrix_task();
+    SCAN_PROFILE_END(PROFILE_RGB_MATRIX);
 #endif
 
 #ifdef WPM_ENABLE
@@ -669,6 +919,10 @@ void matrix_scan_quantum() {
     autoshift_matrix_scan();
 #endif
 
+#ifdef SEND_STRING_ASYNC
+    send_string_task();
+#endif
+
     matrix_scan_kb();
 }
 
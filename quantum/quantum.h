@@ -209,6 +209,13 @@ typedef uint8_t pin_t;
 
 #    define togglePin(pin) (PORTx_ADDRESS(pin) ^= _BV((pin)&0xF))
 
+// Whole port access, a port is named by its first pin
+typedef uint8_t port_data_t;
+
+#    define getPinPort(pin) ((pin) & ~0xF)
+#    define getPinPad(pin) ((pin)&0xF)
+#    define readPort(port) ((port_data_t)PINx_ADDRESS(port))
+
 #elif defined(PROTOCOL_CHIBIOS)
 typedef ioline_t pin_t;
 
@@ -224,6 +231,13 @@ typedef ioline_t pin_t;
 #    define readPin(pin) palReadLine(pin)
 
 #    define togglePin(pin) palToggleLine(pin)
+
+// Whole port access, a port is named by its first pin
+typedef ioportmask_t port_data_t;
+
+#    define getPinPort(pin) PAL_LINE(PAL_PORT(pin), 0)
+#    define getPinPad(pin) PAL_PAD(pin)
+#    define readPort(port) palReadPort(PAL_PORT(port))
 #endif
 
 // Atomic macro to help make GPIO and other controls atomic.
@@ -305,6 +319,12 @@ void send_string_with_delay(const char *str, uint8_t interval);
 void send_string_P(const char *str);
 void send_string_with_delay_P(const char *str, uint8_t interval);
 void send_char(char ascii_code);
+#ifdef SEND_STRING_ASYNC
+typedef uint8_t (*send_string_read_t)(const char *str);
+void send_string_from(const char *str, uint8_t interval, send_string_read_t read, bool bare_codes);
+void send_string_task(void);
+void send_string_flush(void);
+#endif
 
 // For tri-layer
 void          update_tri_layer(uint8_t layer1, uint8_t layer2, uint8_t layer3);
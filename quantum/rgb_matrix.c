@@ -36,6 +36,7 @@ __attribute__((weak)) RGB rgb_matrix_hsv_to_rgb(HSV hsv) { return hsv_to_rgb(hsv
 // Generic effect runners
 #include "rgb_matrix_runners/effect_runner_dx_dy_dist.h"
 #include "rgb_matrix_runners/effect_runner_dx_dy.h"
+#include "rgb_matrix_runners/effect_runner_angle.h"
 #include "rgb_matrix_runners/effect_runner_i.h"
 #include "rgb_matrix_runners/effect_runner_sin_cos_i.h"
 #include "rgb_matrix_runners/effect_runner_reactive.h"
@@ -127,6 +128,13 @@ uint8_t g_rgb_frame_buffer[MATRIX_ROWS][MATRIX_COLS] = {{0}};
 #ifdef RGB_MATRIX_KEYREACTIVE_ENABLED
 last_hit_t g_last_hit_tracker;
 #endif  // RGB_MATRIX_KEYREACTIVE_ENABLED
+#ifdef RGB_MATRIX_DISTANCE_CACHE
+uint8_t g_led_center_dist[DRIVER_LED_TOTAL];
+uint8_t g_led_center_angle[DRIVER_LED_TOTAL];
+#    ifdef RGB_MATRIX_KEYREACTIVE_ENABLED
+const uint8_t *g_last_hit_dist[LED_HITS_TO_REMEMBER];
+#    endif  // RGB_MATRIX_KEYREACTIVE_ENABLED
+#endif      // RGB_MATRIX_DISTANCE_CACHE
 
 // internals
 static uint8_t         rgb_last_enable   = UINT8_MAX;
@@ -143,9 +151,41 @@ static uint32_t rgb_timer_buffer;
 static last_hit_t last_hit_buffer;
 #endif  // RGB_MATRIX_KEYREACTIVE_ENABLED
 
-void eeconfig_read_rgb_matrix(void) { eeprom_read_block(&rgb_matrix_config, EECONFIG_RGB_MATRIX, sizeof(rgb_matrix_config)); }
+#if defined(RGB_MATRIX_DISTANCE_CACHE) && defined(RGB_MATRIX_KEYREACTIVE_ENABLED)
+// Distances from every LED to the LED of a recent hit, computed once per hit
+// instead of every frame. hit_dist_led holds the hit LED of each row.
+static uint8_t hit_dist_cache[LED_HITS_TO_REMEMBER][DRIVER_LED_TOTAL];
+static uint8_t hit_dist_led[LED_HITS_TO_REMEMBER];
+
+static const uint8_t *rgb_matrix_hit_distances(uint8_t led, const last_hit_t *hits) {
+    uint8_t free_row = 0;
+    for (uint8_t row = 0; row < LED_HITS_TO_REMEMBER; row++) {
+        if (hit_dist_led[row] == led) {
+            return hit_dist_cache[row];
+        }
+        // There are as many rows as hits, so one of them isn't used by the current hits
+        bool used = false;
+        for (uint8_t j = 0; j < hits->count; j++) {
+            used |= hit_dist_led[row] == hits->index[j];
+        }
+        if (!used) {
+            free_row = row;
+        }
+    }
+
+    hit_dist_led[free_row] = led;
+    for (uint8_t i = 0; i < DRIVER_LED_TOTAL; i++) {
+        int16_t dx                  = g_led_config.point[i].x - g_led_config.point[led].x;
+        int16_t dy                  = g_led_config.point[i].y - g_led_config.point[led].y;
+        hit_dist_cache[free_row][i] = sqrt16(dx * dx + dy * dy);
+    }
+    return hit_dist_cache[free_row];
+}
+#endif  // defined(RGB_MATRIX_DISTANCE_CACHE) && defined(RGB_MATRIX_KEYREACTIVE_ENABLED)
+
+void eeconfig_read_rgb_matrix(void) { eeconfig_read_block(&rgb_matrix_config, EECONFIG_RGB_MATRIX, sizeof(rgb_matrix_config)); }
 
-void eeconfig_update_rgb_matrix(void) { eeprom_update_block(&rgb_matrix_config, EECONFIG_RGB_MATRIX, sizeof(rgb_matrix_config)); }
+void eeconfig_update_rgb_matrix(void) { eeconfig_update_block(&rgb_matrix_config, EECONFIG_RGB_MATRIX, sizeof(rgb_matrix_config)); }
 
 void eeconfig_update_rgb_matrix_default(void) {
     dprintf("eeconfig_update_rgb_matrix_default\n");
@@ -307,7 +347,12 @@ static void rgb_task_start(void) {
     g_rgb_timer = rgb_timer_buffer;
 #ifdef RGB_MATRIX_KEYREACTIVE_ENABLED
     g_last_hit_tracker = last_hit_buffer;
-#endif  // RGB_MATRIX_KEYREACTIVE_ENABLED
+#    ifdef RGB_MATRIX_DISTANCE_CACHE
+    for (uint8_t j = 0; j < g_last_hit_tracker.count; j++) {
+        g_last_hit_dist[j] = rgb_matrix_hit_distances(g_last_hit_tracker.index[j], &g_last_hit_tracker);
+    }
+#    endif  // RGB_MATRIX_DISTANCE_CACHE
+#endif      // RGB_MATRIX_KEYREACTIVE_ENABLED
 
     // next task
     rgb_task_state = RENDERING;
@@ -463,6 +508,18 @@ void rgb_matrix_init(void) {
     }
 #endif  // RGB_MATRIX_KEYREACTIVE_ENABLED
 
+#ifdef RGB_MATRIX_DISTANCE_CACHE
+    for (uint8_t i = 0; i < DRIVER_LED_TOTAL; i++) {
+        int16_t dx            = g_led_config.point[i].x - k_rgb_matrix_center.x;
+        int16_t dy            = g_led_config.point[i].y - k_rgb_matrix_center.y;
+        g_led_center_dist[i]  = sqrt16(dx * dx + dy * dy);
+        g_led_center_angle[i] = atan2_8(dy, dx);
+    }
+#    ifdef RGB_MATRIX_KEYREACTIVE_ENABLED
+    memset(hit_dist_led, NO_LED, sizeof(hit_dist_led));
+#    endif  // RGB_MATRIX_KEYREACTIVE_ENABLED
+#endif      // RGB_MATRIX_DISTANCE_CACHE
+
     if (!eeconfig_is_enabled()) {
         dprintf("rgb_matrix_init_drivers eeconfig is not enabled.\n");
         eeconfig_init();
@@ -222,6 +222,13 @@ extern led_config_t g_led_config;
 #ifdef RGB_MATRIX_KEYREACTIVE_ENABLED
 extern last_hit_t g_last_hit_tracker;
 #endif
+#ifdef RGB_MATRIX_DISTANCE_CACHE
+extern uint8_t g_led_center_dist[DRIVER_LED_TOTAL];
+extern uint8_t g_led_center_angle[DRIVER_LED_TOTAL];
+#    ifdef RGB_MATRIX_KEYREACTIVE_ENABLED
+extern const uint8_t *g_last_hit_dist[LED_HITS_TO_REMEMBER];
+#    endif
+#endif
 #ifdef RGB_MATRIX_FRAMEBUFFER_EFFECTS
 extern uint8_t g_rgb_frame_buffer[MATRIX_ROWS][MATRIX_COLS];
 #endif
@@ -26,6 +26,7 @@ SOFTWARE.
 #include "serial_link/protocol/frame_validator.h"
 #include "serial_link/protocol/physical.h"
 #include <stdbool.h>
+#include <string.h>
 
 // This implements the "Consistent overhead byte stuffing protocol"
 // https://en.wikipedia.org/wiki/Consistent_Overhead_Byte_Stuffing
@@ -97,30 +98,65 @@ void byte_stuffer_recv_byte(uint8_t link, uint8_t data) {
     }
 }
 
-static void send_block(uint8_t link, uint8_t* start, uint8_t* end, uint8_t num_non_zero) {
-    send_data(link, &num_non_zero, 1);
+// The encoded frame is collected here, so that send_data is called once per
+// frame, or once every SEND_BUFFER_SIZE bytes for long frames. Otherwise data
+// with a lot of zeroes, like a key matrix, would result in two calls per byte.
+#define SEND_BUFFER_SIZE 64
+
+typedef struct send_buffer {
+    uint8_t  link;
+    uint16_t pos;
+    uint8_t  data[SEND_BUFFER_SIZE];
+} send_buffer_t;
+
+static void flush_send_buffer(send_buffer_t* buffer) {
+    if (buffer->pos > 0) {
+        send_data(buffer->link, buffer->data, buffer->pos);
+        buffer->pos = 0;
+    }
+}
+
+static void append_send_buffer(send_buffer_t* buffer, const uint8_t* data, uint16_t size) {
+    while (size > 0) {
+        uint16_t count = SEND_BUFFER_SIZE - buffer->pos;
+        if (count > size) {
+            count = size;
+        }
+        memcpy(buffer->data + buffer->pos, data, count);
+        buffer->pos += count;
+        data += count;
+        size -= count;
+        if (buffer->pos == SEND_BUFFER_SIZE) {
+            flush_send_buffer(buffer);
+        }
+    }
+}
+
+static void send_block(send_buffer_t* buffer, uint8_t* start, uint8_t* end, uint8_t num_non_zero) {
+    append_send_buffer(buffer, &num_non_zero, 1);
     if (end > start) {
-        send_data(link, start, end - start);
+        append_send_buffer(buffer, start, end - start);
     }
 }
 
 void byte_stuffer_send_frame(uint8_t link, uint8_t* data, uint16_t size) {
     const uint8_t zero = 0;
     if (size > 0) {
-        uint16_t num_non_zero = 1;
-        uint8_t* end          = data + size;
-        uint8_t* start        = data;
+        send_buffer_t buffer       = {.link = link, .pos = 0};
+        uint16_t      num_non_zero = 1;
+        uint8_t*      end          = data + size;
+        uint8_t*      start        = data;
         while (data < end) {
             if (num_non_zero == 0xFF) {
                 // There's more data after big non-zero block
                 // So send it, and start a new block
-                send_block(link, start, data, num_non_zero);
+                send_block(&buffer, start, data, num_non_zero);
                 start        = data;
                 num_non_zero = 1;
             } else {
                 if (*data == 0) {
                     // A zero encountered, so send the block
-                    send_block(link, start, data, num_non_zero);
+                    send_block(&buffer, start, data, num_non_zero);
                     start        = data + 1;
                     num_non_zero = 1;
                 } else {
@@ -129,7 +165,8 @@ void byte_stuffer_send_frame(uint8_t link, uint8_t* data, uint16_t size) {
                 ++data;
             }
         }
-        send_block(link, start, data, num_non_zero);
-        send_data(link, &zero, 1);
+        send_block(&buffer, start, data, num_non_zero);
+        append_send_buffer(&buffer, &zero, 1);
+        flush_send_buffer(&buffer);
     }
 }
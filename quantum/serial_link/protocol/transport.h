@@ -71,6 +71,13 @@ typedef struct {
         triple_buffer_end_write_internal(tb);                                                                       \
         signal_data_written();                                                                                      \
     }                                                                                                               \
+    void end_write_if_changed_##name(void) {                                                                        \
+        remote_object_t*        obj = (remote_object_t*)&remote_object_##name;                                      \
+        triple_buffer_object_t* tb  = (triple_buffer_object_t*)obj->buffer;                                         \
+        if (triple_buffer_end_write_if_changed_internal(sizeof(type) + LOCAL_OBJECT_EXTRA, sizeof(type), tb)) {     \
+            signal_data_written();                                                                                  \
+        }                                                                                                           \
+    }                                                                                                               \
     type* read_##name(void) {                                                                                       \
         remote_object_t*        obj   = (remote_object_t*)&remote_object_##name;                                    \
         uint8_t*                start = obj->buffer + LOCAL_OBJECT_SIZE(obj->object_size);                          \
@@ -99,6 +106,15 @@ typedef struct {
         triple_buffer_end_write_internal(tb);                                                                       \
         signal_data_written();                                                                                      \
     }                                                                                                               \
+    void end_write_if_changed_##name(uint8_t slave) {                                                               \
+        remote_object_t* obj   = (remote_object_t*)&remote_object_##name;                                           \
+        uint8_t*         start = obj->buffer;                                                                       \
+        start += slave * LOCAL_OBJECT_SIZE(obj->object_size);                                                       \
+        triple_buffer_object_t* tb = (triple_buffer_object_t*)start;                                                \
+        if (triple_buffer_end_write_if_changed_internal(sizeof(type) + LOCAL_OBJECT_EXTRA, sizeof(type), tb)) {     \
+            signal_data_written();                                                                                  \
+        }                                                                                                           \
+    }                                                                                                               \
     type* read_##name() {                                                                                           \
         remote_object_t*        obj   = (remote_object_t*)&remote_object_##name;                                    \
         uint8_t*                start = obj->buffer + NUM_SLAVES * LOCAL_OBJECT_SIZE(obj->object_size);             \
@@ -123,6 +139,13 @@ typedef struct {
         triple_buffer_end_write_internal(tb);                                                                       \
         signal_data_written();                                                                                      \
     }                                                                                                               \
+    void end_write_if_changed_##name(void) {                                                                        \
+        remote_object_t*        obj = (remote_object_t*)&remote_object_##name;                                      \
+        triple_buffer_object_t* tb  = (triple_buffer_object_t*)obj->buffer;                                         \
+        if (triple_buffer_end_write_if_changed_internal(sizeof(type) + LOCAL_OBJECT_EXTRA, sizeof(type), tb)) {     \
+            signal_data_written();                                                                                  \
+        }                                                                                                           \
+    }                                                                                                               \
     type* read_##name(uint8_t slave) {                                                                              \
         remote_object_t* obj   = (remote_object_t*)&remote_object_##name;                                           \
         uint8_t*         start = obj->buffer + LOCAL_OBJECT_SIZE(obj->object_size);                                 \
@@ -26,16 +26,19 @@ SOFTWARE.
 #include "serial_link/system/serial_link.h"
 #include <stdbool.h>
 #include <stddef.h>
+#include <string.h>
 
 #define GET_READ_INDEX() object->state & 3
 #define GET_WRITE_INDEX() (object->state >> 2) & 3
 #define GET_SHARED_INDEX() (object->state >> 4) & 3
 #define GET_DATA_AVAILABLE() (object->state >> 6) & 1
+#define GET_DATA_PUBLISHED() (object->state >> 7) & 1
 
 #define SET_READ_INDEX(i) object->state = ((object->state & ~3) | i)
 #define SET_WRITE_INDEX(i) object->state = ((object->state & ~(3 << 2)) | (i << 2))
 #define SET_SHARED_INDEX(i) object->state = ((object->state & ~(3 << 4)) | (i << 4))
 #define SET_DATA_AVAILABLE(i) object->state = ((object->state & ~(1 << 6)) | (i << 6))
+#define SET_DATA_PUBLISHED(i) object->state = ((object->state & ~(1 << 7)) | (i << 7))
 
 void triple_buffer_init(triple_buffer_object_t* object) {
     object->state = 0;
@@ -66,12 +69,34 @@ void* triple_buffer_begin_write_internal(uint16_t object_size, triple_buffer_obj
     return object->buffer + object_size * write_index;
 }
 
-void triple_buffer_end_write_internal(triple_buffer_object_t* object) {
-    serial_link_lock();
+// Needs to be called with the lock held
+static void publish(triple_buffer_object_t* object) {
     uint8_t shared_index = GET_SHARED_INDEX();
     uint8_t write_index  = GET_WRITE_INDEX();
     SET_SHARED_INDEX(write_index);
     SET_WRITE_INDEX(shared_index);
     SET_DATA_AVAILABLE(true);
+    SET_DATA_PUBLISHED(true);
+}
+
+void triple_buffer_end_write_internal(triple_buffer_object_t* object) {
+    serial_link_lock();
+    publish(object);
+    serial_link_unlock();
+}
+
+bool triple_buffer_end_write_if_changed_internal(uint16_t object_size, uint16_t compare_size, triple_buffer_object_t* object) {
+    serial_link_lock();
+    if (GET_DATA_PUBLISHED()) {
+        // The newest data is still in the shared buffer if the reader hasn't taken it, otherwise it's in the read buffer
+        uint8_t latest_index = GET_DATA_AVAILABLE() ? GET_SHARED_INDEX() : GET_READ_INDEX();
+        uint8_t write_index  = GET_WRITE_INDEX();
+        if (memcmp(object->buffer + object_size * write_index, object->buffer + object_size * latest_index, compare_size) == 0) {
+            serial_link_unlock();
+            return false;
+        }
+    }
+    publish(object);
     serial_link_unlock();
+    return true;
 }
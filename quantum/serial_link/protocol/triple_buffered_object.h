@@ -25,6 +25,7 @@ SOFTWARE.
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
 
 typedef struct {
     uint8_t state;
@@ -37,8 +38,12 @@ void triple_buffer_init(triple_buffer_object_t* object);
 
 #define triple_buffer_end_write(object) triple_buffer_end_write_internal((triple_buffer_object_t*)object)
 
+// Only publishes the write if it differs from the last one, returns true if it did
+#define triple_buffer_end_write_if_changed(object) triple_buffer_end_write_if_changed_internal(sizeof(*object.buffer[0]), sizeof(*object.buffer[0]), (triple_buffer_object_t*)object)
+
 #define triple_buffer_read(object) (typeof(*object.buffer[0])*)triple_buffer_read_internal(sizeof(*object.buffer[0]), (triple_buffer_object_t*)object)
 
 void* triple_buffer_begin_write_internal(uint16_t object_size, triple_buffer_object_t* object);
 void  triple_buffer_end_write_internal(triple_buffer_object_t* object);
+bool  triple_buffer_end_write_if_changed_internal(uint16_t object_size, uint16_t compare_size, triple_buffer_object_t* object);
 void* triple_buffer_read_internal(uint16_t object_size, triple_buffer_object_t* object);
@@ -0,0 +1,149 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020 QMK
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "gtest/gtest.h"
+#include <chrono>
+#include <vector>
+#include <stdio.h>
+extern "C" {
+#include "serial_link/protocol/byte_stuffer.h"
+#include "serial_link/protocol/frame_validator.h"
+#include "serial_link/protocol/physical.h"
+#include "serial_link/protocol/triple_buffered_object.h"
+}
+
+// Host side throughput of the serial link send and receive paths. The
+// numbers depend on the computer, so compare them against a run of the base
+// branch rather than against fixed values.
+
+namespace {
+const unsigned NUM_FRAMES  = 100000;
+const uint16_t OBJECT_SIZE = 32;
+// Room for the object id, the router byte and the CRC, like LOCAL_OBJECT_EXTRA
+const uint16_t OBJECT_EXTRA = 16;
+
+std::vector<uint8_t> sent_data;
+unsigned             send_calls      = 0;
+unsigned             received_frames = 0;
+
+typedef std::chrono::steady_clock clock;
+
+double elapsed_ns(clock::time_point start) { return std::chrono::duration<double, std::nano>(clock::now() - start).count(); }
+
+// A mostly empty key matrix, the worst case for the byte stuffing
+void fill_object(uint8_t* object, unsigned i) {
+    memset(object, 0, OBJECT_SIZE);
+    object[i % OBJECT_SIZE] = 1 << (i % 8);
+    object[3]               = 0x20;
+}
+}  // namespace
+
+extern "C" {
+void send_data(uint8_t link, const uint8_t* data, uint16_t size) {
+    send_calls++;
+    sent_data.insert(sent_data.end(), data, data + size);
+}
+
+void route_incoming_frame(uint8_t link, uint8_t* data, uint16_t size) {
+    if (size == OBJECT_SIZE + 1) {
+        received_frames++;
+    }
+}
+}
+
+class SerialLinkBenchmark : public testing::Test {
+   public:
+    SerialLinkBenchmark() {
+        init_byte_stuffer();
+        sent_data.clear();
+        sent_data.reserve(NUM_FRAMES * 64);
+        send_calls      = 0;
+        received_frames = 0;
+    }
+};
+
+TEST_F(SerialLinkBenchmark, sends_frames) {
+    uint8_t frame[OBJECT_SIZE + OBJECT_EXTRA];
+
+    clock::time_point start = clock::now();
+    for (unsigned i = 0; i < NUM_FRAMES; i++) {
+        fill_object(frame, i);
+        frame[OBJECT_SIZE] = 1;
+        validator_send_frame(0, frame, OBJECT_SIZE + 1);
+    }
+    double ns = elapsed_ns(start);
+
+    printf("[ BENCH    ] send: %.0f ns/frame, %.1f MB/s encoded, %.2f send_data calls/frame\n", ns / NUM_FRAMES, sent_data.size() / ns * 1e3, (double)send_calls / NUM_FRAMES);
+    // The encoded frame is handed to the physical layer in one piece
+    EXPECT_EQ(send_calls, NUM_FRAMES);
+}
+
+TEST_F(SerialLinkBenchmark, receives_frames) {
+    uint8_t frame[OBJECT_SIZE + OBJECT_EXTRA];
+    for (unsigned i = 0; i < NUM_FRAMES; i++) {
+        fill_object(frame, i);
+        frame[OBJECT_SIZE] = 1;
+        validator_send_frame(0, frame, OBJECT_SIZE + 1);
+    }
+
+    clock::time_point start = clock::now();
+    for (uint8_t byte : sent_data) {
+        byte_stuffer_recv_byte(0, byte);
+    }
+    double ns = elapsed_ns(start);
+
+    printf("[ BENCH    ] receive: %.0f ns/frame, %.1f MB/s encoded\n", ns / NUM_FRAMES, sent_data.size() / ns * 1e3);
+    EXPECT_EQ(received_frames, NUM_FRAMES);
+}
+
+TEST_F(SerialLinkBenchmark, skips_unchanged_objects) {
+    struct {
+        uint8_t state;
+        uint8_t buffer[3][OBJECT_SIZE + OBJECT_EXTRA] __attribute__((aligned(4)));
+    } object;
+    triple_buffer_object_t* tb = (triple_buffer_object_t*)&object;
+    triple_buffer_init(tb);
+
+    unsigned          published = 0;
+    clock::time_point start     = clock::now();
+    for (unsigned i = 0; i < NUM_FRAMES; i++) {
+        uint8_t* data = (uint8_t*)triple_buffer_begin_write_internal(OBJECT_SIZE + OBJECT_EXTRA, tb);
+        // Changes once every 100 writes, like a matrix that is scanned much faster than it's typed on
+        fill_object(data, i / 100);
+        if (triple_buffer_end_write_if_changed_internal(OBJECT_SIZE + OBJECT_EXTRA, OBJECT_SIZE, tb)) {
+            published++;
+        }
+        if (triple_buffer_read_internal(OBJECT_SIZE + OBJECT_EXTRA, tb)) {
+            uint8_t frame[OBJECT_SIZE + OBJECT_EXTRA];
+            fill_object(frame, i / 100);
+            frame[OBJECT_SIZE] = 1;
+            validator_send_frame(0, frame, OBJECT_SIZE + 1);
+        }
+    }
+    double ns = elapsed_ns(start);
+
+    printf("[ BENCH    ] change detection: %.0f ns/write, %u of %u writes sent\n", ns / NUM_FRAMES, published, NUM_FRAMES);
+    EXPECT_EQ(published, NUM_FRAMES / 100);
+    EXPECT_EQ(send_calls, NUM_FRAMES / 100);
+}
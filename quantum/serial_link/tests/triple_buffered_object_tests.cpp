@@ -78,3 +78,29 @@ TEST_F(TripleBufferedObject, performs_two_writes_in_the_middle_of_read) {
     EXPECT_EQ(*triple_buffer_read(&test_object), 3);
     EXPECT_EQ(triple_buffer_read(&test_object), nullptr);
 }
+
+TEST_F(TripleBufferedObject, publishes_first_write_if_changed) {
+    *triple_buffer_begin_write(&test_object) = 0;
+    EXPECT_TRUE(triple_buffer_end_write_if_changed(&test_object));
+    EXPECT_EQ(*triple_buffer_read(&test_object), 0);
+}
+
+TEST_F(TripleBufferedObject, does_not_publish_unchanged_write) {
+    *triple_buffer_begin_write(&test_object) = 1;
+    EXPECT_TRUE(triple_buffer_end_write_if_changed(&test_object));
+    *triple_buffer_begin_write(&test_object) = 1;
+    EXPECT_FALSE(triple_buffer_end_write_if_changed(&test_object));
+    EXPECT_EQ(*triple_buffer_read(&test_object), 1);
+    *triple_buffer_begin_write(&test_object) = 1;
+    EXPECT_FALSE(triple_buffer_end_write_if_changed(&test_object));
+    EXPECT_EQ(triple_buffer_read(&test_object), nullptr);
+}
+
+TEST_F(TripleBufferedObject, publishes_changed_write_after_read) {
+    *triple_buffer_begin_write(&test_object) = 1;
+    triple_buffer_end_write_if_changed(&test_object);
+    EXPECT_EQ(*triple_buffer_read(&test_object), 1);
+    *triple_buffer_begin_write(&test_object) = 2;
+    EXPECT_TRUE(triple_buffer_end_write_if_changed(&test_object));
+    EXPECT_EQ(*triple_buffer_read(&test_object), 2);
+}
@@ -0,0 +1,11 @@
+#include "crc8.h"
+
+uint8_t crc8(uint8_t crc, const uint8_t *data, uint8_t length) {
+    while (length--) {
+        crc ^= *data++;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+        }
+    }
+    return crc;
+}
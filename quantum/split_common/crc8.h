@@ -0,0 +1,7 @@
+#pragma once
+
+#include <stdint.h>
+
+// CRC-8 with polynomial 0x07, used to check the data sent between the halves.
+// Pass 0 to start a new CRC, or a previous result to continue it.
+uint8_t crc8(uint8_t crc, const uint8_t *data, uint8_t length);
@@ -23,6 +23,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "split_util.h"
 #include "config.h"
 #include "transport.h"
+#include "scan_profile.h"
+#include "matrix_port_scan.h"
 
 #define ERROR_DISCONNECT_COUNT 5
 
@@ -108,12 +110,26 @@ static void init_pins(void) {
     for (uint8_t x = 0; x < MATRIX_COLS; x++) {
         setPinInputHigh_atomic(col_pins[x]);
     }
+#        ifdef MATRIX_PORT_SCAN
+    matrix_port_scan_init(col_pins, MATRIX_COLS);
+#        endif
 }
 
 static bool read_cols_on_row(matrix_row_t current_matrix[], uint8_t current_row) {
     // Start with a clear matrix row
     matrix_row_t current_row_value = 0;
 
+#        ifdef MATRIX_PORT_SCAN
+    // Select row and read all cols once they have settled
+    select_row(current_row);
+    current_row_value = matrix_port_scan_read_stable();
+    unselect_row(current_row);
+
+    // Pressed keys pulled cols low, wait for them to recover before the next row
+    if (current_row_value) {
+        matrix_port_scan_wait_idle();
+    }
+#        else
     // Select row and wait for row selecton to stabilize
     select_row(current_row);
     matrix_io_delay();
@@ -129,6 +145,7 @@ static bool read_cols_on_row(matrix_row_t current_matrix[], uint8_t current_row)
 
     // Unselect row
     unselect_row(current_row);
+#        endif
 
     // If the row has changed, store the row and return the changed flag.
     if (current_matrix[current_row] != current_row_value) {
@@ -249,7 +266,11 @@ void matrix_post_scan(void) {
     if (is_keyboard_master()) {
         static uint8_t error_count;
 
-        if (!transport_master(matrix + thatHand)) {
+        SCAN_PROFILE_BEGIN(PROFILE_TRANSPORT);
+        bool transport_ok = transport_master(matrix + thatHand);
+        SCAN_PROFILE_END(PROFILE_TRANSPORT);
+
+        if (!transport_ok) {
             error_count++;
 
             if (error_count > ERROR_DISCONNECT_COUNT) {
@@ -264,7 +285,9 @@ void matrix_post_scan(void) {
 
         matrix_scan_quantum();
     } else {
+        SCAN_PROFILE_BEGIN(PROFILE_TRANSPORT);
         transport_slave(matrix + thisHand);
+        SCAN_PROFILE_END(PROFILE_TRANSPORT);
 
         matrix_slave_scan_user();
     }
@@ -285,7 +308,9 @@ uint8_t matrix_scan(void) {
     }
 #endif
 
+    SCAN_PROFILE_BEGIN(PROFILE_DEBOUNCE);
     debounce(raw_matrix, matrix + thisHand, ROWS_PER_HAND, changed);
+    SCAN_PROFILE_END(PROFILE_DEBOUNCE);
 
     matrix_post_scan();
     return (uint8_t)changed;
@@ -25,28 +25,51 @@ static pin_t encoders_pad[] = ENCODERS_PAD_A;
 
 #    include "i2c_master.h"
 #    include "i2c_slave.h"
+#    include "crc8.h"
 
-typedef struct _I2C_slave_buffer_t {
+// Bump whenever the layout of I2C_slave_buffer_t changes, so that a master
+// paired with a slave running older firmware doesn't misread it
+#    define I2C_TRANSPORT_VERSION 1
+
+// Written by the slave and read by the master in a single transfer. The
+// sequence number changes whenever the rest of the frame does, and the CRC
+// catches frames that the master read while the slave was updating them.
+// The single bytes go last, so they don't add padding after the matrix.
+typedef struct _I2C_s2m_t {
     matrix_row_t smatrix[ROWS_PER_HAND];
-    uint8_t      backlight_level;
-#    if defined(RGBLIGHT_ENABLE) && defined(RGBLIGHT_SPLIT)
-    rgblight_syncinfo_t rgblight_sync;
-#    endif
 #    ifdef ENCODER_ENABLE
     uint8_t encoder_state[NUMBER_OF_ENCODERS];
 #    endif
+    uint8_t version;
+    uint8_t sequence;
+    uint8_t crc;
+} I2C_s2m_t;
+
+// Written by the master in a single transfer, only when something in it changed
+typedef struct _I2C_m2s_t {
+    uint8_t backlight_level;
 #    ifdef WPM_ENABLE
     uint8_t current_wpm;
 #    endif
+} I2C_m2s_t;
+
+typedef struct _I2C_slave_buffer_t {
+    I2C_s2m_t s2m;
+    I2C_m2s_t m2s;
+#    if defined(RGBLIGHT_ENABLE) && defined(RGBLIGHT_SPLIT)
+    rgblight_syncinfo_t rgblight_sync;
+#    endif
 } I2C_slave_buffer_t;
 
+_Static_assert(sizeof(I2C_slave_buffer_t) <= I2C_SLAVE_REG_COUNT, "I2C_slave_buffer_t doesn't fit into the I2C slave registers");
+
 static I2C_slave_buffer_t *const i2c_buffer = (I2C_slave_buffer_t *)i2c_slave_reg;
 
-#    define I2C_BACKLIGHT_START offsetof(I2C_slave_buffer_t, backlight_level)
+#    define I2C_S2M_START offsetof(I2C_slave_buffer_t, s2m)
+#    define I2C_M2S_START offsetof(I2C_slave_buffer_t, m2s)
 #    define I2C_RGB_START offsetof(I2C_slave_buffer_t, rgblight_sync)
-#    define I2C_KEYMAP_START offsetof(I2C_slave_buffer_t, smatrix)
-#    define I2C_ENCODER_START offsetof(I2C_slave_buffer_t, encoder_state)
-#    define I2C_WPM_START offsetof(I2C_slave_buffer_t, current_wpm)
+#    define I2C_S2M_CRC_LENGTH offsetof(I2C_s2m_t, crc)
+#    define I2C_S2M_DATA_LENGTH offsetof(I2C_s2m_t, sequence)
 
 #    define TIMEOUT 100
 
@@ -54,53 +77,121 @@ static I2C_slave_buffer_t *const i2c_buffer = (I2C_slave_buffer_t *)i2c_slave_re
 #        define SLAVE_I2C_ADDRESS 0x32
 #    endif
 
+#    ifdef I2C_ASYNC_ENABLE
+static void __attribute__((unused)) transport_transfer_done(i2c_status_t status, void *failed) {
+    if (status < 0) {
+        *(bool *)failed = true;
+    }
+}
+
+// Queued writes report failures through the flag, so they are sent again on the next scan.
+// Without I2C_ASYNC_ENABLE the result is known right away and the flag stays false.
+#        define TRANSPORT_WRITE(reg, data, size, failed) (failed = false, i2c_writeReg_async(SLAVE_I2C_ADDRESS, reg, data, size, TIMEOUT, transport_transfer_done, &failed))
+#    else
+#        define TRANSPORT_WRITE(reg, data, size, failed) i2c_writeReg(SLAVE_I2C_ADDRESS, reg, data, size, TIMEOUT)
+#    endif
+
 // Get rows from other half over i2c
 bool transport_master(matrix_row_t matrix[]) {
-    i2c_readReg(SLAVE_I2C_ADDRESS, I2C_KEYMAP_START, (void *)matrix, sizeof(i2c_buffer->smatrix), TIMEOUT);
+    static uint8_t last_sequence;
+    static bool    synced = false;
+
+#    ifdef I2C_ASYNC_ENABLE
+    // Use the frame read while the previous scan went on, and queue the read for the next one
+    static I2C_s2m_t next_s2m;
+    static bool      read_failed = false;
+
+    i2c_flush();
+    I2C_s2m_t s2m     = next_s2m;
+    bool      read_ok = !read_failed;
+    read_failed       = false;
+    i2c_readReg_async(SLAVE_I2C_ADDRESS, I2C_S2M_START, (void *)&next_s2m, sizeof(next_s2m), TIMEOUT, transport_transfer_done, &read_failed);
+#    else
+    I2C_s2m_t s2m;
+    bool      read_ok = i2c_readReg(SLAVE_I2C_ADDRESS, I2C_S2M_START, (void *)&s2m, sizeof(s2m), TIMEOUT) >= 0;
+#    endif
 
-    // write backlight info
-#    ifdef BACKLIGHT_ENABLE
-    uint8_t level = is_backlight_enabled() ? get_backlight_level() : 0;
-    if (level != i2c_buffer->backlight_level) {
-        if (i2c_writeReg(SLAVE_I2C_ADDRESS, I2C_BACKLIGHT_START, (void *)&level, sizeof(level), TIMEOUT) >= 0) {
-            i2c_buffer->backlight_level = level;
+    // Where the version is depends on the layout, so it is only looked at in a
+    // frame that passed the CRC. That is checked before anything is written.
+    bool frame_ok = read_ok && s2m.crc == crc8(0, (uint8_t *)&s2m, I2C_S2M_CRC_LENGTH);
+    if (frame_ok && s2m.version != I2C_TRANSPORT_VERSION) {
+        // Version 0 is a slave that hasn't filled in its buffer yet
+        static bool reported = false;
+        if (s2m.version != 0 && !reported) {
+            dprintf("split: slave uses I2C transport version %u, expected %u\n", s2m.version, I2C_TRANSPORT_VERSION);
+            reported = true;
+        }
+        // Don't write anything either, the slave may expect it elsewhere
+        synced = false;
+        return false;
+    }
+
+#    if defined(BACKLIGHT_ENABLE) || defined(WPM_ENABLE)
+    static bool m2s_failed = false;
+    I2C_m2s_t   m2s        = {0};
+#        ifdef BACKLIGHT_ENABLE
+    m2s.backlight_level = is_backlight_enabled() ? get_backlight_level() : 0;
+#        endif
+#        ifdef WPM_ENABLE
+    m2s.current_wpm = get_current_wpm();
+#        endif
+    if (memcmp(&m2s, &i2c_buffer->m2s, sizeof(m2s)) != 0 || m2s_failed) {
+        if (TRANSPORT_WRITE(I2C_M2S_START, (void *)&m2s, sizeof(m2s), m2s_failed) >= 0) {
+            i2c_buffer->m2s = m2s;
         }
     }
 #    endif
 
 #    if defined(RGBLIGHT_ENABLE) && defined(RGBLIGHT_SPLIT)
-    if (rgblight_get_change_flags()) {
-        rgblight_syncinfo_t rgblight_sync;
-        rgblight_get_syncinfo(&rgblight_sync);
-        if (i2c_writeReg(SLAVE_I2C_ADDRESS, I2C_RGB_START, (void *)&rgblight_sync, sizeof(rgblight_sync), TIMEOUT) >= 0) {
+    static bool rgblight_failed = false;
+    if (rgblight_get_change_flags() || rgblight_failed) {
+        // Kept around in case it has to be sent again
+        static rgblight_syncinfo_t rgblight_sync;
+        if (rgblight_get_change_flags()) {
+            rgblight_get_syncinfo(&rgblight_sync);
+        }
+        if (TRANSPORT_WRITE(I2C_RGB_START, (void *)&rgblight_sync, sizeof(rgblight_sync), rgblight_failed) >= 0) {
             rgblight_clear_change_flags();
         }
     }
 #    endif
 
+    if (!frame_ok) {
+        synced = false;
+        return false;
+    }
+
+    // Nothing to do until the slave has something new
+    if (!synced || s2m.sequence != last_sequence) {
+        memcpy(matrix, s2m.smatrix, sizeof(s2m.smatrix));
 #    ifdef ENCODER_ENABLE
-    i2c_readReg(SLAVE_I2C_ADDRESS, I2C_ENCODER_START, (void *)i2c_buffer->encoder_state, sizeof(i2c_buffer->encoder_state), TIMEOUT);
-    encoder_update_raw(i2c_buffer->encoder_state);
+        encoder_update_raw(s2m.encoder_state);
 #    endif
-
-#    ifdef WPM_ENABLE
-    uint8_t current_wpm = get_current_wpm();
-    if (current_wpm != i2c_buffer->current_wpm) {
-        if (i2c_writeReg(SLAVE_I2C_ADDRESS, I2C_WPM_START, (void *)&current_wpm, sizeof(current_wpm), TIMEOUT) >= 0) {
-            i2c_buffer->current_wpm = current_wpm;
-        }
+        last_sequence = s2m.sequence;
+        synced        = true;
     }
-#    endif
     return true;
 }
 
 void transport_slave(matrix_row_t matrix[]) {
-    // Copy matrix to I2C buffer
-    memcpy((void *)i2c_buffer->smatrix, (void *)matrix, sizeof(i2c_buffer->smatrix));
+    I2C_s2m_t s2m;
+    memset(&s2m, 0, sizeof(s2m));
+    s2m.version = I2C_TRANSPORT_VERSION;
+    memcpy(s2m.smatrix, matrix, sizeof(s2m.smatrix));
+#    ifdef ENCODER_ENABLE
+    encoder_state_raw(s2m.encoder_state);
+#    endif
+
+    // Only touch the frame when it changes, which keeps the window for torn reads small
+    if (memcmp(&s2m, &i2c_buffer->s2m, I2C_S2M_DATA_LENGTH) != 0) {
+        s2m.sequence    = i2c_buffer->s2m.sequence + 1;
+        s2m.crc         = crc8(0, (uint8_t *)&s2m, I2C_S2M_CRC_LENGTH);
+        i2c_buffer->s2m = s2m;
+    }
 
 // Read Backlight Info
 #    ifdef BACKLIGHT_ENABLE
-    backlight_set(i2c_buffer->backlight_level);
+    backlight_set(i2c_buffer->m2s.backlight_level);
 #    endif
 
 #    if defined(RGBLIGHT_ENABLE) && defined(RGBLIGHT_SPLIT)
@@ -111,12 +202,8 @@ void transport_slave(matrix_row_t matrix[]) {
     }
 #    endif
 
-#    ifdef ENCODER_ENABLE
-    encoder_state_raw(i2c_buffer->encoder_state);
-#    endif
-
 #    ifdef WPM_ENABLE
-    set_current_wpm(i2c_buffer->current_wpm);
+    set_current_wpm(i2c_buffer->m2s.current_wpm);
 #    endif
 }
 
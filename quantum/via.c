@@ -43,6 +43,7 @@
 #include "via.h"
 
 #include "raw_hid.h"
+#include "scan_profile.h"
 #include "dynamic_keymap.h"
 #include "tmk_core/common/eeprom.h"
 #include "version.h"  // for QMK_BUILDDATE used in EEPROM magic
@@ -116,6 +117,8 @@ void via_init(void) {
         dynamic_keymap_reset();
         // This resets the macros in EEPROM to nothing.
         dynamic_keymap_macro_reset();
+        // Make sure the keymaps and macros are in EEPROM before the magic
+        dynamic_keymap_flush();
         // Save the magic number last, in case saving was interrupted
         via_eeprom_set_valid(true);
     }
@@ -375,6 +378,8 @@ void raw_hid_receive(uint8_t *data, uint8_t length) {
             break;
         }
         case id_bootloader_jump: {
+            // Don't lose any keymap changes that haven't been written yet
+            dynamic_keymap_flush();
             // Need to send data back before the jump
             // Informs host that the command is handled
             raw_hid_send(data, length);
@@ -384,6 +389,11 @@ void raw_hid_receive(uint8_t *data, uint8_t length) {
             break;
         }
         default: {
+#ifdef SCAN_PROFILE_ENABLE
+            if (scan_profile_raw_hid_receive(data, length)) {
+                break;
+            }
+#endif
             // The command ID is not known
             // Return the unhandled state
             *command_id = id_unhandled;
@@ -0,0 +1,78 @@
+/* Copyright 2020 QMK
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_common.hpp"
+
+using testing::_;
+using testing::AnyNumber;
+using testing::InSequence;
+
+class ActionCache : public TestFixture {
+   protected:
+    void tap_and_expect(TestDriver& driver, uint8_t col, uint8_t row, uint8_t keycode) {
+        press_key(col, row);
+        EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(keycode)));
+        run_one_scan_loop();
+        testing::Mock::VerifyAndClearExpectations(&driver);
+
+        release_key(col, row);
+        EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+        run_one_scan_loop();
+        testing::Mock::VerifyAndClearExpectations(&driver);
+    }
+};
+
+TEST_F(ActionCache, BaseLayer) {
+    TestDriver driver;
+    tap_and_expect(driver, 0, 0, KC_A);
+    tap_and_expect(driver, 2, 1, KC_F);
+}
+
+TEST_F(ActionCache, TransparentKeysFallThrough) {
+    TestDriver driver;
+    press_key(3, 0);
+    run_one_scan_loop();
+    tap_and_expect(driver, 0, 0, KC_1);
+    tap_and_expect(driver, 1, 0, KC_B);
+    tap_and_expect(driver, 2, 1, KC_3);
+    release_key(3, 0);
+    run_one_scan_loop();
+}
+
+TEST_F(ActionCache, UncachedLayer) {
+    TestDriver driver;
+    press_key(3, 0);
+    press_key(3, 1);
+    run_one_scan_loop();
+    run_one_scan_loop();
+    tap_and_expect(driver, 2, 0, KC_2);
+    tap_and_expect(driver, 0, 0, KC_1);
+    tap_and_expect(driver, 1, 0, KC_B);
+    tap_and_expect(driver, 2, 1, KC_3);
+    release_key(3, 0);
+    release_key(3, 1);
+    run_one_scan_loop();
+    run_one_scan_loop();
+}
+
+TEST_F(ActionCache, FollowsKeymapConfig) {
+    TestDriver driver;
+    tap_and_expect(driver, 0, 1, KC_LALT);
+    keymap_config.swap_lalt_lgui = true;
+    tap_and_expect(driver, 0, 1, KC_LGUI);
+    keymap_config.swap_lalt_lgui = false;
+    tap_and_expect(driver, 0, 1, KC_LALT);
+}
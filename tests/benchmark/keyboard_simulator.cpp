@@ -0,0 +1,197 @@
+/* Copyright 2020 QMK
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "keyboard_simulator.hpp"
+#include <stdio.h>
+#include <fstream>
+#include <sstream>
+#include "test_matrix.h"
+
+extern "C" {
+#include "quantum.h"
+void advance_time(uint32_t ms);
+}
+
+KeyboardSimulator* KeyboardSimulator::m_this = nullptr;
+
+KeyboardSimulator::KeyboardSimulator() : m_driver{&KeyboardSimulator::keyboard_leds, &KeyboardSimulator::send_keyboard, &KeyboardSimulator::send_mouse, &KeyboardSimulator::send_system, &KeyboardSimulator::send_consumer} {
+    m_previous_driver = host_get_driver();
+    host_set_driver(&m_driver);
+    m_this = this;
+}
+
+KeyboardSimulator::~KeyboardSimulator() {
+    host_set_driver(m_previous_driver);
+    m_this = nullptr;
+}
+
+uint8_t KeyboardSimulator::keyboard_leds(void) { return 0; }
+
+void KeyboardSimulator::send_keyboard(report_keyboard_t* report) {
+    KeyboardSimulator* self = m_this;
+    if (!self) return;
+
+    clock::time_point now = clock::now();
+    self->m_reports++;
+    // Every change that happened since the last report is resolved by this one
+    while (!self->m_pending.empty()) {
+        const PendingChange& change = self->m_pending.front();
+        uint32_t             scans  = self->m_scan - change.scan + 1;
+        double               ns     = std::chrono::duration<double, std::nano>(now - change.wall).count();
+        if (scans > self->m_max_latency_scans) self->m_max_latency_scans = scans;
+        if (ns > self->m_max_latency_ns) self->m_max_latency_ns = ns;
+        self->m_total_latency_scans += scans;
+        self->m_resolved++;
+        self->m_pending.pop_front();
+    }
+}
+
+void KeyboardSimulator::send_mouse(report_mouse_t* report) {}
+
+void KeyboardSimulator::send_system(uint16_t data) {}
+
+void KeyboardSimulator::send_consumer(uint16_t data) {}
+
+void KeyboardSimulator::scan(BenchmarkResult& result, unsigned& unprocessed_changes, double& idle_ns) {
+    clock::time_point start = clock::now();
+    keyboard_task();
+    double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+
+    result.scans++;
+    result.total_ns += ns;
+    // keyboard_task() consumes a limited number of matrix changes per call,
+    // so a scan counts as an event scan while there are changes left over.
+    if (unprocessed_changes) {
+#if defined(KEYBOARD_EVENT_QUEUE)
+        unprocessed_changes = unprocessed_changes > KEYBOARD_EVENT_QUEUE_SIZE ? unprocessed_changes - KEYBOARD_EVENT_QUEUE_SIZE : 0;
+#elif defined(QMK_KEYS_PER_SCAN)
+        unprocessed_changes = unprocessed_changes > QMK_KEYS_PER_SCAN ? unprocessed_changes - QMK_KEYS_PER_SCAN : 0;
+#else
+        unprocessed_changes--;
+#endif
+        result.event_scans++;
+        result.event_scan_mean_ns += ns;
+        if (ns > result.event_scan_max_ns) result.event_scan_max_ns = ns;
+    } else {
+        idle_ns += ns;
+    }
+
+    m_scan++;
+    advance_time(1);
+}
+
+BenchmarkResult KeyboardSimulator::run(const Trace& trace, unsigned iterations, uint32_t settle_ms) {
+    BenchmarkResult result = {};
+    unsigned        unprocessed_changes = 0;
+    double          idle_ns             = 0;
+
+    m_pending.clear();
+    m_scan                = 0;
+    m_reports             = 0;
+    m_max_latency_scans   = 0;
+    m_total_latency_scans = 0;
+    m_resolved            = 0;
+    m_max_latency_ns      = 0;
+
+    for (unsigned i = 0; i < iterations; i++) {
+        uint32_t start = timer_read32();
+        size_t   next  = 0;
+        while (next < trace.size()) {
+            uint32_t now = timer_read32() - start;
+            for (; next < trace.size() && trace[next].time <= now; next++) {
+                const TraceEvent& event = trace[next];
+                if (event.pressed) {
+                    press_key(event.col, event.row);
+                } else {
+                    release_key(event.col, event.row);
+                }
+                if (event.expect_report) {
+                    m_pending.push_back(PendingChange{m_scan, clock::now()});
+                }
+                unprocessed_changes++;
+                result.events++;
+            }
+            scan(result, unprocessed_changes, idle_ns);
+        }
+    }
+    for (uint32_t i = 0; i < settle_ms; i++) {
+        scan(result, unprocessed_changes, idle_ns);
+    }
+
+    result.reports           = m_reports;
+    result.unreported_events = m_pending.size();
+    result.max_latency_scans = m_max_latency_scans;
+    result.max_latency_ns    = m_max_latency_ns;
+    if (m_resolved) {
+        result.mean_latency_scans = (double)m_total_latency_scans / m_resolved;
+    }
+    if (result.event_scans) {
+        result.event_scan_mean_ns /= result.event_scans;
+    }
+    if (result.scans > result.event_scans) {
+        result.idle_scan_mean_ns = idle_ns / (result.scans - result.event_scans);
+    }
+    if (result.total_ns > 0) {
+        result.events_per_second = result.events / (result.total_ns / 1e9);
+    }
+    m_pending.clear();
+    return result;
+}
+
+void KeyboardSimulator::reset(void) {
+    clear_all_keys();
+    layer_clear();
+    for (unsigned i = 0; i < TAPPING_TERM * 2 + 10; i++) {
+        keyboard_task();
+        advance_time(1);
+    }
+    clear_keyboard();
+    m_pending.clear();
+}
+
+bool KeyboardSimulator::load_trace(const std::string& path, Trace& trace) {
+    std::ifstream file(path);
+    if (!file) {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        unsigned           time, row, col;
+        std::string        state, flag;
+        if (!(fields >> time >> row >> col >> state) || (state != "d" && state != "u") || row >= MATRIX_ROWS || col >= MATRIX_COLS) {
+            return false;
+        }
+        fields >> flag;
+        trace.push_back(TraceEvent{time, (uint8_t)row, (uint8_t)col, state == "d", flag != "n"});
+    }
+    return true;
+}
+
+void KeyboardSimulator::print_result(const char* name, const BenchmarkResult& result) {
+    printf("[ BENCH    ] %s\n", name);
+    printf("[ BENCH    ]   events: %zu, reports: %zu, scans: %zu (%zu with events)\n", result.events, result.reports, result.scans, result.event_scans);
+    printf("[ BENCH    ]   event scan: mean %.0f ns, max %.0f ns; idle scan: mean %.0f ns\n", result.event_scan_mean_ns, result.event_scan_max_ns, result.idle_scan_mean_ns);
+    printf("[ BENCH    ]   throughput: %.0f events/s\n", result.events_per_second);
+    printf("[ BENCH    ]   matrix change to report: mean %.2f scans, max %u scans, max %.0f ns\n", result.mean_latency_scans, result.max_latency_scans, result.max_latency_ns);
+    if (result.unreported_events) {
+        printf("[ BENCH    ]   %zu events never produced a report\n", result.unreported_events);
+    }
+}
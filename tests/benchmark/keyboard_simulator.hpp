@@ -0,0 +1,109 @@
+/* Copyright 2020 QMK
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+#include "host.h"
+
+// A single matrix change in a keystroke trace.
+// time is in milliseconds relative to the start of the trace, and every
+// millisecond of simulated time is one keyboard_task() call.
+// Events that are not expected to produce a report on their own (for example
+// pressing a MO() key) should set expect_report to false, otherwise they are
+// attributed the latency of whatever report eventually follows them.
+struct TraceEvent {
+    uint32_t time;
+    uint8_t  row;
+    uint8_t  col;
+    bool     pressed;
+    bool     expect_report;
+};
+
+typedef std::vector<TraceEvent> Trace;
+
+struct BenchmarkResult {
+    size_t events;
+    size_t reports;
+    size_t scans;
+    size_t event_scans;
+    size_t unreported_events;
+    // Host CPU time spent inside keyboard_task(), in nanoseconds
+    double total_ns;
+    double event_scan_mean_ns;
+    double event_scan_max_ns;
+    double idle_scan_mean_ns;
+    double events_per_second;
+    // Latency from the matrix change to host_keyboard_send()
+    uint32_t max_latency_scans;
+    double   mean_latency_scans;
+    double   max_latency_ns;
+};
+
+// Feeds keystroke traces through the real keyboard_task()/action_exec() path
+// using the fake matrix from tests/test_common, and measures the cost of
+// processing them on the host.
+class KeyboardSimulator {
+   public:
+    KeyboardSimulator();
+    ~KeyboardSimulator();
+
+    // Replay the trace `iterations` times, then keep scanning for settle_ms
+    // so that pending tapping/combo timeouts are resolved.
+    BenchmarkResult run(const Trace& trace, unsigned iterations = 1, uint32_t settle_ms = 1000);
+
+    // Release all keys and layers and scan until the keyboard is idle again.
+    void reset(void);
+
+    // Load a recorded trace. Each non-empty line that doesn't start with '#'
+    // has the form "<time_ms> <row> <col> <d|u> [n]", where the optional
+    // trailing 'n' marks an event that doesn't produce a report by itself.
+    static bool load_trace(const std::string& path, Trace& trace);
+
+    static void print_result(const char* name, const BenchmarkResult& result);
+
+   private:
+    typedef std::chrono::steady_clock clock;
+
+    struct PendingChange {
+        size_t            scan;
+        clock::time_point wall;
+    };
+
+    static uint8_t keyboard_leds(void);
+    static void    send_keyboard(report_keyboard_t* report);
+    static void    send_mouse(report_mouse_t* report);
+    static void    send_system(uint16_t data);
+    static void    send_consumer(uint16_t data);
+
+    void scan(BenchmarkResult& result, unsigned& unprocessed_changes, double& idle_ns);
+
+    host_driver_t             m_driver;
+    host_driver_t*            m_previous_driver;
+    std::deque<PendingChange> m_pending;
+    size_t                    m_scan;
+    size_t                    m_reports;
+    uint32_t                  m_max_latency_scans;
+    uint64_t                  m_total_latency_scans;
+    size_t                    m_resolved;
+    double                    m_max_latency_ns;
+    static KeyboardSimulator* m_this;
+};
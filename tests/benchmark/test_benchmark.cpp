@@ -0,0 +1,163 @@
+/* Copyright 2020 QMK
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <algorithm>
+#include "gtest/gtest.h"
+#include "keyboard_simulator.hpp"
+
+extern "C" {
+#include "quantum.h"
+}
+
+// Number of times each synthetic trace is replayed, to get stable timings
+#ifndef BENCHMARK_ITERATIONS
+#    define BENCHMARK_ITERATIONS 200
+#endif
+
+namespace {
+
+struct KeyPos {
+    uint8_t row;
+    uint8_t col;
+};
+
+const KeyPos LT1_SPC = {3, 4};
+const KeyPos MO3     = {3, 3};
+
+// Position of a letter (or space) on layer 0 of the benchmark keymap
+KeyPos letter_pos(char c) {
+    static const char* rows[] = {" qwertyuiop", " asdfghjkl", " zxcvbnm"};
+    if (c == ' ') return LT1_SPC;
+    for (uint8_t row = 0; row < 3; row++) {
+        for (uint8_t col = 1; rows[row][col]; col++) {
+            if (rows[row][col] == c) return KeyPos{row, col};
+        }
+    }
+    return KeyPos{0, 0};
+}
+
+void tap(Trace& trace, uint32_t time, KeyPos key, uint32_t hold, bool expect_report = true) {
+    trace.push_back(TraceEvent{time, key.row, key.col, true, expect_report});
+    trace.push_back(TraceEvent{time + hold, key.row, key.col, false, expect_report});
+}
+
+void sort_trace(Trace& trace) {
+    std::stable_sort(trace.begin(), trace.end(), [](const TraceEvent& a, const TraceEvent& b) { return a.time < b.time; });
+}
+
+// Overlapping keystrokes at roughly 150 words per minute
+Trace typing_trace(const char* text) {
+    Trace    trace;
+    uint32_t time = 0;
+    for (const char* c = text; *c; c++, time += 80) {
+        tap(trace, time, letter_pos(*c), 100);
+    }
+    sort_trace(trace);
+    return trace;
+}
+
+}  // namespace
+
+class Benchmark : public testing::Test {
+   public:
+    static void SetUpTestCase() {
+        KeyboardSimulator simulator;
+        keyboard_init();
+    }
+
+   protected:
+    void TearDown() override { simulator.reset(); }
+
+    BenchmarkResult run(const char* name, const Trace& trace, unsigned iterations = BENCHMARK_ITERATIONS) {
+        simulator.reset();
+        BenchmarkResult result = simulator.run(trace, iterations);
+        KeyboardSimulator::print_result(name, result);
+        RecordProperty("events_per_second", (int)result.events_per_second);
+        RecordProperty("event_scan_mean_ns", (int)result.event_scan_mean_ns);
+        RecordProperty("event_scan_max_ns", (int)result.event_scan_max_ns);
+        RecordProperty("max_latency_scans", (int)result.max_latency_scans);
+        return result;
+    }
+
+    KeyboardSimulator simulator;
+};
+
+TEST_F(Benchmark, Typing) {
+    BenchmarkResult result = run("typing", typing_trace("pack my box with five dozen liquor jugs"));
+    EXPECT_EQ(result.unreported_events, 0);
+    // Mod-taps on the home row are only resolved when they are released
+    EXPECT_LE(result.max_latency_scans, TAPPING_TERM + 1);
+}
+
+TEST_F(Benchmark, RolloverChord) {
+    Trace                trace;
+    static const KeyPos  chord[] = {{0, 5}, {0, 6}, {0, 7}, {0, 10}, {2, 5}, {2, 6}};
+    for (uint32_t time = 0; time < 1000; time += 100) {
+        for (const KeyPos& key : chord) {
+            tap(trace, time, key, 50);
+        }
+    }
+    sort_trace(trace);
+    BenchmarkResult result = run("rollover chord", trace);
+    EXPECT_EQ(result.unreported_events, 0);
+}
+
+TEST_F(Benchmark, LayerStack) {
+    Trace trace;
+    // Hold the transparent layer 3 and the number layer, then type on both
+    tap(trace, 0, MO3, 1000, false);
+    tap(trace, 10, LT1_SPC, 900, false);
+    for (uint32_t time = TAPPING_TERM + 50; time < 900; time += 50) {
+        tap(trace, time, KeyPos{0, (uint8_t)(1 + (time / 50) % 10)}, 30);
+    }
+    sort_trace(trace);
+    BenchmarkResult result = run("layer stack", trace);
+    EXPECT_EQ(result.unreported_events, 0);
+    // A report for every key typed on the layers, and one for each of the four
+    // layer changes, which clear the keyboard report
+    EXPECT_EQ(result.reports, trace.size() * BENCHMARK_ITERATIONS);
+    EXPECT_LE(result.max_latency_scans, 1);
+}
+
+TEST_F(Benchmark, Combos) {
+    Trace trace;
+    // Combo keys are held back until the combo either completes or times out
+    static const KeyPos combos[][2] = {{{0, 2}, {0, 3}}, {{0, 8}, {0, 9}}, {{2, 2}, {2, 3}}, {{2, 7}, {2, 8}}};
+    uint32_t            time        = 0;
+    for (const auto& combo : combos) {
+        tap(trace, time, combo[0], 60);
+        tap(trace, time + 5, combo[1], 60);
+        time += 150;
+    }
+    sort_trace(trace);
+    BenchmarkResult result = run("combos", trace);
+    EXPECT_EQ(result.unreported_events, 0);
+}
+
+// Replays a recorded trace, see KeyboardSimulator::load_trace for the format:
+//   QMK_BENCHMARK_TRACE=path/to/trace.txt make test:benchmark
+TEST_F(Benchmark, RecordedTrace) {
+    const char* path = getenv("QMK_BENCHMARK_TRACE");
+    if (!path) {
+        printf("[ BENCH    ] QMK_BENCHMARK_TRACE not set, skipping recorded trace\n");
+        return;
+    }
+    Trace trace;
+    ASSERT_TRUE(KeyboardSimulator::load_trace(path, trace)) << "Failed to load " << path;
+    sort_trace(trace);
+    run(path, trace, 1);
+}
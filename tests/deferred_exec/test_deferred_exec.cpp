@@ -0,0 +1,137 @@
+/* Copyright 2020 QMK
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_common.hpp"
+
+extern "C" {
+#include "deferred_exec.h"
+}
+
+using testing::_;
+using testing::AnyNumber;
+using testing::InSequence;
+
+namespace {
+struct Counter {
+    unsigned calls;
+    unsigned repeats;
+    uint32_t period;
+};
+
+uint32_t count_callback(uint32_t trigger_time, void* cb_arg) {
+    Counter* counter = static_cast<Counter*>(cb_arg);
+    counter->calls++;
+    return counter->calls < counter->repeats ? counter->period : 0;
+}
+}  // namespace
+
+class DeferredExec : public TestFixture {};
+
+TEST_F(DeferredExec, RunsOnceDelayHasPassed) {
+    TestDriver driver;
+    Counter counter = {0, 1, 0};
+    EXPECT_NE(defer_exec(10, count_callback, &counter), INVALID_DEFERRED_TOKEN);
+    idle_for(10);
+    EXPECT_EQ(counter.calls, 0u);
+    run_one_scan_loop();
+    EXPECT_EQ(counter.calls, 1u);
+    idle_for(20);
+    EXPECT_EQ(counter.calls, 1u);
+}
+
+TEST_F(DeferredExec, RepeatsWithReturnedDelay) {
+    TestDriver driver;
+    Counter counter = {0, 3, 5};
+    defer_exec(5, count_callback, &counter);
+    idle_for(6);
+    EXPECT_EQ(counter.calls, 1u);
+    idle_for(5);
+    EXPECT_EQ(counter.calls, 2u);
+    idle_for(5);
+    EXPECT_EQ(counter.calls, 3u);
+    idle_for(20);
+    EXPECT_EQ(counter.calls, 3u);
+}
+
+TEST_F(DeferredExec, RunsInDeadlineOrder) {
+    TestDriver driver;
+    Counter early = {0, 1, 0};
+    Counter late  = {0, 1, 0};
+    defer_exec(20, count_callback, &late);
+    defer_exec(5, count_callback, &early);
+    idle_for(6);
+    EXPECT_EQ(early.calls, 1u);
+    EXPECT_EQ(late.calls, 0u);
+    idle_for(15);
+    EXPECT_EQ(late.calls, 1u);
+}
+
+TEST_F(DeferredExec, CancelAndExtend) {
+    TestDriver driver;
+    Counter        cancelled = {0, 1, 0};
+    Counter        extended  = {0, 1, 0};
+    deferred_token token     = defer_exec(5, count_callback, &cancelled);
+    deferred_token other     = defer_exec(5, count_callback, &extended);
+    EXPECT_TRUE(cancel_deferred_exec(token));
+    EXPECT_FALSE(cancel_deferred_exec(token));
+    idle_for(3);
+    EXPECT_TRUE(extend_deferred_exec(other, 10));
+    idle_for(10);
+    EXPECT_EQ(extended.calls, 0u);
+    run_one_scan_loop();
+    EXPECT_EQ(extended.calls, 1u);
+    EXPECT_EQ(cancelled.calls, 0u);
+    EXPECT_FALSE(extend_deferred_exec(other, 10));
+}
+
+TEST_F(DeferredExec, FailsWhenFull) {
+    Counter        counter = {0, 1, 0};
+    deferred_token tokens[DEFERRED_EXEC_MAX_TASKS];
+    for (auto& token : tokens) {
+        token = defer_exec(100, count_callback, &counter);
+        EXPECT_NE(token, INVALID_DEFERRED_TOKEN);
+    }
+    EXPECT_EQ(defer_exec(100, count_callback, &counter), INVALID_DEFERRED_TOKEN);
+    for (auto& token : tokens) {
+        cancel_deferred_exec(token);
+    }
+}
+
+TEST_F(DeferredExec, ComboKeyIsSentAfterComboTerm) {
+    TestDriver driver;
+    InSequence s;
+    // Combos are only armed once a key outside of them has been processed
+    EXPECT_CALL(driver, send_keyboard_mock(_)).Times(AnyNumber());
+    press_key(3, 0);
+    run_one_scan_loop();
+    release_key(3, 0);
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    press_key(0, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(_)).Times(0);
+    idle_for(COMBO_TERM + 1);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    // The buffered key is registered and then sent once more
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_A))).Times(2);
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    release_key(0, 0);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    run_one_scan_loop();
+}
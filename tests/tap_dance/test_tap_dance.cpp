@@ -0,0 +1,101 @@
+/* Copyright 2020 QMK
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_common.hpp"
+
+using testing::_;
+using testing::AnyNumber;
+using testing::InSequence;
+
+class TapDance : public TestFixture {
+   protected:
+    void tap(uint8_t col) {
+        press_key(col, 0);
+        run_one_scan_loop();
+        release_key(col, 0);
+        run_one_scan_loop();
+    }
+
+    // Finishing and resetting a dance sends extra reports for the mods it restores
+    void expect_tap(TestDriver& driver, uint8_t keycode) {
+        EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport())).Times(AnyNumber());
+        EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(keycode)));
+        EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport())).Times(AnyNumber());
+    }
+};
+
+TEST_F(TapDance, SingleTapFinishesAfterTappingTerm) {
+    TestDriver driver;
+    InSequence s;
+    EXPECT_CALL(driver, send_keyboard_mock(_)).Times(0);
+    tap(0);
+    idle_for(TAPPING_TERM - 2);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    expect_tap(driver, KC_A);
+    idle_for(2);
+}
+
+TEST_F(TapDance, DoubleTap) {
+    TestDriver driver;
+    InSequence s;
+    expect_tap(driver, KC_B);
+    tap(0);
+    tap(0);
+    idle_for(TAPPING_TERM + 1);
+}
+
+TEST_F(TapDance, InterruptedByAnotherKey) {
+    TestDriver driver;
+    InSequence s;
+    tap(0);
+    expect_tap(driver, KC_A);
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_C)));
+    press_key(2, 0);
+    run_one_scan_loop();
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport()));
+    release_key(2, 0);
+    run_one_scan_loop();
+}
+
+TEST_F(TapDance, MoreDancesThanTracked) {
+    TestDriver driver;
+    InSequence s;
+    // Held past the tapping term, so it stays in flight until released
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport())).Times(AnyNumber());
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_A))).Times(AnyNumber());
+    press_key(0, 0);
+    idle_for(TAPPING_TERM + 2);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    // There is no room to track the second dance
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_A))).Times(AnyNumber());
+    tap(1);
+    idle_for(TAPPING_TERM - 2);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_A))).Times(AnyNumber());
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_A, KC_X)));
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport(KC_A))).Times(AnyNumber());
+    idle_for(2);
+    testing::Mock::VerifyAndClearExpectations(&driver);
+
+    EXPECT_CALL(driver, send_keyboard_mock(KeyboardReport())).Times(AnyNumber());
+    release_key(0, 0);
+    run_one_scan_loop();
+}
@@ -54,6 +54,16 @@ else
     TMK_COMMON_SRC += $(COMMON_DIR)/magic.c
 endif
 
+ifeq ($(strip $(DEFERRED_EXEC_ENABLE)), yes)
+    TMK_COMMON_SRC += $(COMMON_DIR)/deferred_exec.c
+    TMK_COMMON_DEFS += -DDEFERRED_EXEC_ENABLE
+endif
+
+ifeq ($(strip $(SCAN_PROFILE_ENABLE)), yes)
+    TMK_COMMON_SRC += $(COMMON_DIR)/scan_profile.c
+    TMK_COMMON_DEFS += -DSCAN_PROFILE_ENABLE
+endif
+
 SHARED_EP_ENABLE = no
 MOUSE_SHARED_EP ?= yes
 ifeq ($(strip $(KEYBOARD_SHARED_EP)), yes)
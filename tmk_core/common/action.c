@@ -26,6 +26,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "action_util.h"
 #include "action.h"
 #include "wait.h"
+#include "scan_profile.h"
 
 #ifdef BACKLIGHT_ENABLE
 #    include "backlight.h"
@@ -200,7 +201,11 @@ void process_record(keyrecord_t *record) {
         return;
     }
 
-    if (!process_record_quantum(record)) {
+    SCAN_PROFILE_BEGIN(PROFILE_PROCESS_RECORD);
+    bool process = process_record_quantum(record);
+    SCAN_PROFILE_END(PROFILE_PROCESS_RECORD);
+
+    if (!process) {
 #ifndef NO_ACTION_ONESHOT
         if (is_oneshot_layer_active() && record->event.pressed) {
             clear_oneshot_layer_state(ONESHOT_OTHER_KEY_PRESSED);
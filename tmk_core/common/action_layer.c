@@ -252,6 +252,17 @@ action_t store_or_get_action(bool pressed, keypos_t key) {
  */
 uint8_t layer_switch_get_layer(keypos_t key) {
 #ifndef NO_ACTION_LAYER
+#    ifdef KEYMAP_ACTION_CACHE_LAYERS
+    /* only look at the layers the key isn't transparent on, top layer first */
+    layer_state_t layers = (layer_state | default_layer_state) & keymap_layers_with_action(key);
+    while (layers) {
+        uint8_t i = get_highest_layer(layers);
+        if (i < KEYMAP_ACTION_CACHE_LAYERS || action_for_key(i, key).code != ACTION_TRANSPARENT) {
+            return i;
+        }
+        layers &= ~((layer_state_t)1 << i);
+    }
+#    else
     action_t action;
     action.code = ACTION_TRANSPARENT;
 
@@ -265,6 +276,7 @@ uint8_t layer_switch_get_layer(keypos_t key) {
             }
         }
     }
+#    endif
     /* fall back to layer 0 */
     return 0;
 #else
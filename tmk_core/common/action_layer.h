@@ -120,3 +120,9 @@ uint8_t layer_switch_get_layer(keypos_t key);
 
 /* return action depending on current layer status */
 action_t layer_switch_get_action(keypos_t key);
+
+#ifdef KEYMAP_ACTION_CACHE_LAYERS
+/* decoded actions of the lower layers, see keymap_common.c */
+layer_state_t keymap_layers_with_action(keypos_t key);
+void          keymap_action_cache_invalidate(void);
+#endif
@@ -9,6 +9,11 @@
 #include "timer.h"
 #include "led.h"
 #include "host.h"
+#include "eeconfig.h"
+
+#ifdef DYNAMIC_KEYMAP_ENABLE
+#    include "dynamic_keymap.h"
+#endif
 
 #ifdef PROTOCOL_LUFA
 #    include "lufa.h"
@@ -127,6 +132,10 @@ static void power_down(uint8_t wdto) {
  * FIXME: needs doc
  */
 void suspend_power_down(void) {
+    eeconfig_flush();
+#ifdef DYNAMIC_KEYMAP_ENABLE
+    dynamic_keymap_flush();
+#endif
     suspend_power_down_kb();
 
 #ifndef NO_SUSPEND_POWER_DOWN
@@ -17,6 +17,7 @@
  */
 
 #include <stdio.h>
+#include <stdbool.h>
 #include <string.h>
 #include "eeprom_stm32.h"
 /*****************************************************************************
@@ -27,13 +28,91 @@
  ******************************************************************************/
 
 /* Private macro -------------------------------------------------------------*/
+#define FEE_HALFWORD(address) (*(__IO uint16_t *)(address))
+#define FEE_XSTR(s) #s
+#define FEE_STR(s) FEE_XSTR(s)
+
+// Log records are an address followed by the value and its complement, so a
+// record that was interrupted halfway through can be told apart.
+#define FEE_RECORD_VALUE(value) ((uint16_t)(((uint8_t)~(value) << 8) | (value)))
+#define FEE_RECORD_VALID(data) (((data) >> 8) == (uint8_t)~(data))
+
 /* Private variables ---------------------------------------------------------*/
+static uint8_t  DataBuf[FEE_DENSITY_BYTES];
+static uint8_t  ActiveBank  = 0;
+static uint16_t LogRecord   = 0;
+static bool     FlashUsable = false;
+
+// The initial values of .data are the last thing the ChibiOS linker scripts put in flash
+extern uint8_t __textdata_base__[], __data_base__[], __data_end__[];
+
+// eeprom_stm32.ld fails the link if the firmware reaches into the reserved pages
+#ifndef EEPROM_START_ADDRESS
+#    define FEE_LINK_PAGE_BASE "0x8000000 + " FEE_STR(FEE_MCU_FLASH_SIZE) " * 1024 - " FEE_STR(FEE_DENSITY_PAGES) " * " FEE_STR(FEE_PAGE_SIZE)
+#else
+#    define FEE_LINK_PAGE_BASE "0xFFFFFFFF"
+#endif
+__asm__(".global __fee_page_base__\n.set __fee_page_base__, " FEE_LINK_PAGE_BASE "\n");
+
 /* Functions -----------------------------------------------------------------*/
 
-uint8_t DataBuf[FEE_PAGE_SIZE];
 /*****************************************************************************
- *  Delete Flash Space used for user Data, deletes the whole space between
- *  RW_PAGE_BASE_ADDRESS and the last uC Flash Page
+ *  The flash size isn't known at link time when the board sets its own
+ *  EEPROM_START_ADDRESS, so check that the firmware doesn't reach into the
+ *  pages before erasing anything.
+ ******************************************************************************/
+static bool EEPROM_PagesFree(void) {
+    uint32_t image_end = (uint32_t)__textdata_base__ + (uint32_t)(__data_end__ - __data_base__);
+    return image_end <= FEE_PAGE_BASE_ADDRESS;
+}
+
+// A bank that was just compacted into hasn't logged anything yet
+static bool EEPROM_LogEmpty(uint8_t bank) { return FEE_HALFWORD(FEE_BANK_ADDRESS(bank) + FEE_LOG_OFFSET) == FEE_EMPTY_WORD; }
+
+static FLASH_Status EEPROM_EraseBank(uint8_t bank) {
+    FLASH_Status FlashStatus = FLASH_COMPLETE;
+
+    for (int page_num = 0; page_num < FEE_BANK_PAGES; page_num++) {
+        uint32_t page = FEE_BANK_ADDRESS(bank) + (page_num * FEE_PAGE_SIZE);
+        // skip pages which are already blank, erasing is slow and wears the flash
+        for (uint32_t i = 0; i < FEE_PAGE_SIZE; i += 2) {
+            if (FEE_HALFWORD(page + i) != FEE_EMPTY_WORD) {
+                FlashStatus = FLASH_ErasePage(page);
+                break;
+            }
+        }
+    }
+    return FlashStatus;
+}
+
+/*****************************************************************************
+ *  Write the contents of the RAM buffer as a snapshot into the other bank,
+ *  then switch to it. The old bank is only erased once the new one is valid.
+ ******************************************************************************/
+static FLASH_Status EEPROM_Compact(void) {
+    uint8_t      bank = !ActiveBank;
+    FLASH_Status FlashStatus;
+
+    FlashStatus = EEPROM_EraseBank(bank);
+    for (int i = 0; i < FEE_DENSITY_BYTES; i += 2) {
+        uint16_t data = DataBuf[i] | (DataBuf[i + 1] << 8);
+        if (data != FEE_EMPTY_WORD) {
+            FlashStatus = FLASH_ProgramHalfWord(FEE_BANK_ADDRESS(bank) + FEE_SNAPSHOT_OFFSET + i, data);
+        }
+    }
+    FlashStatus = FLASH_ProgramHalfWord(FEE_BANK_ADDRESS(bank), FEE_BANK_ACTIVE);
+
+    FLASH_ProgramHalfWord(FEE_BANK_ADDRESS(ActiveBank), FEE_BANK_OBSOLETE);
+    EEPROM_EraseBank(ActiveBank);
+
+    ActiveBank = bank;
+    LogRecord  = 0;
+    return FlashStatus;
+}
+
+/*****************************************************************************
+ *  Unlock the flash and rebuild the RAM buffer from the snapshot and the log
+ *  of the active bank. If there is no valid bank, the whole space is erased.
  ******************************************************************************/
 uint16_t EEPROM_Init(void) {
     // unlock flash
@@ -42,6 +121,46 @@ uint16_t EEPROM_Init(void) {
     // Clear Flags
     // FLASH_ClearFlag(FLASH_SR_EOP|FLASH_SR_PGERR|FLASH_SR_WRPERR);
 
+    FlashUsable = EEPROM_PagesFree();
+    if (!FlashUsable) {
+        // the firmware is too large for the reserved pages, keep the contents in RAM only
+        memset(DataBuf, 0xFF, sizeof(DataBuf));
+        return FEE_DENSITY_BYTES;
+    }
+
+    bool bank0 = FEE_HALFWORD(FEE_BANK_ADDRESS(0)) == FEE_BANK_ACTIVE;
+    bool bank1 = FEE_HALFWORD(FEE_BANK_ADDRESS(1)) == FEE_BANK_ACTIVE;
+
+    if (!bank0 && !bank1) {
+        EEPROM_Erase();
+        return FEE_DENSITY_BYTES;
+    }
+
+    // Power was lost during compaction after both banks became valid. The old bank's log is
+    // full and misses the write that started the compaction, so keep the new one, whose log is empty.
+    if (bank0 && bank1) {
+        uint8_t obsolete = (EEPROM_LogEmpty(1) && !EEPROM_LogEmpty(0)) ? 0 : 1;
+        FLASH_ProgramHalfWord(FEE_BANK_ADDRESS(obsolete), FEE_BANK_OBSOLETE);
+        EEPROM_EraseBank(obsolete);
+        bank0 = obsolete != 0;
+    }
+    ActiveBank = bank0 ? 0 : 1;
+
+    memcpy(DataBuf, (uint8_t *)(FEE_BANK_ADDRESS(ActiveBank) + FEE_SNAPSHOT_OFFSET), FEE_DENSITY_BYTES);
+
+    for (LogRecord = 0; LogRecord < FEE_LOG_RECORDS; LogRecord++) {
+        uint32_t record  = FEE_BANK_ADDRESS(ActiveBank) + FEE_LOG_OFFSET + LogRecord * 4;
+        uint16_t Address = FEE_HALFWORD(record);
+        uint16_t data    = FEE_HALFWORD(record + 2);
+
+        if (Address == FEE_EMPTY_WORD) {
+            break;
+        }
+        if (Address < FEE_DENSITY_BYTES && FEE_RECORD_VALID(data)) {
+            DataBuf[Address] = (uint8_t)data;
+        }
+    }
+
     return FEE_DENSITY_BYTES;
 }
 /*****************************************************************************
@@ -50,55 +169,53 @@ uint16_t EEPROM_Init(void) {
 void EEPROM_Erase(void) {
     int page_num = 0;
 
+    memset(DataBuf, 0xFF, sizeof(DataBuf));
+    ActiveBank = 0;
+    LogRecord  = 0;
+    if (!FlashUsable) {
+        return;
+    }
+
     // delete all pages from specified start page to the last page
     do {
         FLASH_ErasePage(FEE_PAGE_BASE_ADDRESS + (page_num * FEE_PAGE_SIZE));
         page_num++;
     } while (page_num < FEE_DENSITY_PAGES);
+
+    FLASH_ProgramHalfWord(FEE_BANK_ADDRESS(0), FEE_BANK_ACTIVE);
 }
 /*****************************************************************************
- *  Writes once data byte to flash on specified address. If a byte is already
- *  written, the whole page must be copied to a buffer, the byte changed and
- *  the manipulated buffer written after PageErase.
+ *  Writes once data byte to flash on specified address. The change is
+ *  appended to the log of the active bank, and only once the log is full are
+ *  the contents compacted into the other bank, which erases a page.
  *******************************************************************************/
 uint16_t EEPROM_WriteDataByte(uint16_t Address, uint8_t DataByte) {
     FLASH_Status FlashStatus = FLASH_COMPLETE;
 
-    uint32_t page;
-    int      i;
-
-    // exit if desired address is above the limit (e.G. under 2048 Bytes for 4 pages)
-    if (Address > FEE_DENSITY_BYTES) {
+    // exit if desired address is above the limit
+    if (Address >= FEE_DENSITY_BYTES) {
         return 0;
     }
 
-    // calculate which page is affected (Pagenum1/Pagenum2...PagenumN)
-    page = FEE_ADDR_OFFSET(Address) / FEE_PAGE_SIZE;
-
-    // if current data is 0xFF, the byte is empty, just overwrite with the new one
-    if ((*(__IO uint16_t *)(FEE_PAGE_BASE_ADDRESS + FEE_ADDR_OFFSET(Address))) == FEE_EMPTY_WORD) {
-        FlashStatus = FLASH_ProgramHalfWord(FEE_PAGE_BASE_ADDRESS + FEE_ADDR_OFFSET(Address), (uint16_t)(0x00FF & DataByte));
-    } else {
-        // Copy Page to a buffer
-        memcpy(DataBuf, (uint8_t *)FEE_PAGE_BASE_ADDRESS + (page * FEE_PAGE_SIZE), FEE_PAGE_SIZE);  // !!! Calculate base address for the desired page
-
-        // check if new data is differ to current data, return if not, proceed if yes
-        if (DataByte == *(__IO uint8_t *)(FEE_PAGE_BASE_ADDRESS + FEE_ADDR_OFFSET(Address))) {
-            return 0;
-        }
+    // check if new data is differ to current data, return if not, proceed if yes
+    if (DataBuf[Address] == DataByte) {
+        return FlashStatus;
+    }
+    DataBuf[Address] = DataByte;
 
-        // manipulate desired data byte in temp data array if new byte is differ to the current
-        DataBuf[FEE_ADDR_OFFSET(Address) % FEE_PAGE_SIZE] = DataByte;
+    if (!FlashUsable) {
+        return FLASH_BAD_ADDRESS;
+    }
 
-        // Erase Page
-        FlashStatus = FLASH_ErasePage(FEE_PAGE_BASE_ADDRESS + (page * FEE_PAGE_SIZE));
+    if (LogRecord >= FEE_LOG_RECORDS) {
+        return EEPROM_Compact();
+    }
 
-        // Write new data (whole page) to flash if data has been changed
-        for (i = 0; i < (FEE_PAGE_SIZE / 2); i++) {
-            if ((__IO uint16_t)(0xFF00 | DataBuf[FEE_ADDR_OFFSET(i)]) != 0xFFFF) {
-                FlashStatus = FLASH_ProgramHalfWord((FEE_PAGE_BASE_ADDRESS + (page * FEE_PAGE_SIZE)) + (i * 2), (uint16_t)(0xFF00 | DataBuf[FEE_ADDR_OFFSET(i)]));
-            }
-        }
+    uint32_t record = FEE_BANK_ADDRESS(ActiveBank) + FEE_LOG_OFFSET + LogRecord * 4;
+    LogRecord++;
+    FlashStatus = FLASH_ProgramHalfWord(record, Address);
+    if (FlashStatus == FLASH_COMPLETE) {
+        FlashStatus = FLASH_ProgramHalfWord(record + 2, FEE_RECORD_VALUE(DataByte));
     }
     return FlashStatus;
 }
@@ -109,7 +226,9 @@ uint8_t EEPROM_ReadDataByte(uint16_t Address) {
     uint8_t DataByte = 0xFF;
 
     // Get Byte from specified address
-    DataByte = (*(__IO uint8_t *)(FEE_PAGE_BASE_ADDRESS + FEE_ADDR_OFFSET(Address)));
+    if (Address < FEE_DENSITY_BYTES) {
+        DataByte = DataBuf[Address];
+    }
 
     return DataByte;
 }
@@ -17,8 +17,13 @@
  *
  * This library assumes 8-bit data locations. To add a new MCU, please provide the flash
  * page size and the total flash size in Kb. The number of available pages must be a multiple
- * of 2. Only half of the pages account for the total EEPROM size.
+ * of 2, as they are split into two banks that take turns holding the data.
  * This library also assumes that the pages are not used by the firmware.
+ *
+ * The active bank starts with a snapshot of the EEPROM contents, followed by a log of
+ * (address, value) records. Writes are appended to the log, and only when it is full is
+ * the current contents compacted into a new snapshot in the other bank. The contents are
+ * kept in RAM, and rebuilt from the snapshot and the log on startup.
  */
 
 #pragma once
@@ -41,13 +46,21 @@
 #    error "not implemented."
 #endif
 
+// The page counts keep the EEPROM sizes of the old one byte per halfword layout,
+// each bank needs room for the header, a snapshot of the EEPROM and the log.
 #ifndef EEPROM_PAGE_SIZE
 #    if defined(MCU_STM32F103RB) || defined(MCU_STM32F042K6)
-#        define FEE_PAGE_SIZE (uint16_t)0x400  // Page size = 1KByte
-#        define FEE_DENSITY_PAGES 2            // How many pages are used
+#        define FEE_PAGE_SIZE 0x400     // Page size = 1KByte
+#        define FEE_DENSITY_PAGES 4     // How many pages are used
+#        ifndef FEE_DENSITY_BYTES
+#            define FEE_DENSITY_BYTES 1024
+#        endif
 #    elif defined(MCU_STM32F103ZE) || defined(MCU_STM32F103RE) || defined(MCU_STM32F103RD) || defined(MCU_STM32F303CC) || defined(MCU_STM32F072CB)
-#        define FEE_PAGE_SIZE (uint16_t)0x800  // Page size = 2KByte
-#        define FEE_DENSITY_PAGES 4            // How many pages are used
+#        define FEE_PAGE_SIZE 0x800     // Page size = 2KByte
+#        define FEE_DENSITY_PAGES 6     // How many pages are used
+#        ifndef FEE_DENSITY_BYTES
+#            define FEE_DENSITY_BYTES 4096
+#        endif
 #    else
 #        error "No MCU type specified. Add something like -DMCU_STM32F103RB to your compiler arguments (probably in a Makefile)."
 #    endif
@@ -72,10 +85,29 @@
 // DONT CHANGE
 // Choose location for the first EEPROM Page address on the top of flash
 #define FEE_PAGE_BASE_ADDRESS ((uint32_t)(0x8000000 + FEE_MCU_FLASH_SIZE * 1024 - FEE_DENSITY_PAGES * FEE_PAGE_SIZE))
-#define FEE_DENSITY_BYTES ((FEE_PAGE_SIZE / 2) * FEE_DENSITY_PAGES - 1)
 #define FEE_LAST_PAGE_ADDRESS (FEE_PAGE_BASE_ADDRESS + (FEE_PAGE_SIZE * FEE_DENSITY_PAGES))
 #define FEE_EMPTY_WORD ((uint16_t)0xFFFF)
-#define FEE_ADDR_OFFSET(Address) (Address * 2)  // 1Byte per Word will be saved to preserve Flash
+
+// Each bank holds a header, a snapshot of the whole EEPROM and the write log
+#define FEE_BANK_PAGES (FEE_DENSITY_PAGES / 2)
+#define FEE_BANK_SIZE (FEE_PAGE_SIZE * FEE_BANK_PAGES)
+#define FEE_BANK_ADDRESS(bank) (FEE_PAGE_BASE_ADDRESS + (bank)*FEE_BANK_SIZE)
+#define FEE_BANK_ACTIVE ((uint16_t)0x5AA5)
+#define FEE_BANK_OBSOLETE ((uint16_t)0x0000)
+
+// Size of the emulated EEPROM, without a default for the MCU half of a bank goes to the log
+#ifndef FEE_DENSITY_BYTES
+#    define FEE_DENSITY_BYTES (FEE_BANK_SIZE / 2)
+#endif
+#define FEE_SNAPSHOT_OFFSET 4
+#define FEE_LOG_OFFSET (FEE_SNAPSHOT_OFFSET + FEE_DENSITY_BYTES)
+#define FEE_LOG_RECORDS ((FEE_BANK_SIZE - FEE_LOG_OFFSET) / 4)
+
+#if FEE_DENSITY_PAGES % 2 != 0
+#    error "FEE_DENSITY_PAGES must be a multiple of 2"
+#endif
+_Static_assert(FEE_DENSITY_BYTES % 2 == 0, "FEE_DENSITY_BYTES must be even");
+_Static_assert(FEE_LOG_RECORDS >= 16, "FEE_DENSITY_BYTES is too large, there has to be room left in the bank for the write log");
 
 // Use this function to initialize the functionality
 uint16_t EEPROM_Init(void);
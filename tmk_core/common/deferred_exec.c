@@ -0,0 +1,137 @@
+/* Copyright 2020 QMK
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include "deferred_exec.h"
+#include "timer.h"
+
+typedef struct {
+    deferred_token         token;
+    uint32_t               trigger_time;
+    deferred_exec_callback callback;
+    void *                 cb_arg;
+} deferred_executor_t;
+
+static deferred_executor_t executors[DEFERRED_EXEC_MAX_TASKS];
+static deferred_token      last_token   = INVALID_DEFERRED_TOKEN;
+static uint8_t             active_count = 0;
+// No callback is due before this, it may be earlier than the actual first deadline
+static uint32_t next_trigger = 0;
+
+// Deadlines are less than half the timer range away, so this survives wraparound
+static inline bool is_due(uint32_t trigger_time, uint32_t now) { return (int32_t)(now - trigger_time) >= 0; }
+
+static deferred_executor_t *find_executor(deferred_token token) {
+    if (token == INVALID_DEFERRED_TOKEN) {
+        return NULL;
+    }
+    for (uint8_t i = 0; i < DEFERRED_EXEC_MAX_TASKS; i++) {
+        if (executors[i].token == token) {
+            return &executors[i];
+        }
+    }
+    return NULL;
+}
+
+static void schedule(deferred_executor_t *executor, uint32_t trigger_time) {
+    executor->trigger_time = trigger_time;
+    if (active_count == 1 || is_due(trigger_time, next_trigger)) {
+        next_trigger = trigger_time;
+    }
+}
+
+deferred_token defer_exec(uint32_t delay_ms, deferred_exec_callback callback, void *cb_arg) {
+    deferred_executor_t *executor = NULL;
+    for (uint8_t i = 0; i < DEFERRED_EXEC_MAX_TASKS && !executor; i++) {
+        if (executors[i].token == INVALID_DEFERRED_TOKEN) {
+            executor = &executors[i];
+        }
+    }
+    if (!executor || !callback) {
+        return INVALID_DEFERRED_TOKEN;
+    }
+
+    // Skip the invalid token and any still in use
+    do {
+        last_token++;
+    } while (last_token == INVALID_DEFERRED_TOKEN || find_executor(last_token));
+
+    executor->token    = last_token;
+    executor->callback = callback;
+    executor->cb_arg   = cb_arg;
+    active_count++;
+    schedule(executor, timer_read32() + delay_ms);
+    return executor->token;
+}
+
+bool extend_deferred_exec(deferred_token token, uint32_t delay_ms) {
+    deferred_executor_t *executor = find_executor(token);
+    if (!executor) {
+        return false;
+    }
+    schedule(executor, timer_read32() + delay_ms);
+    return true;
+}
+
+bool cancel_deferred_exec(deferred_token token) {
+    deferred_executor_t *executor = find_executor(token);
+    if (!executor) {
+        return false;
+    }
+    executor->token = INVALID_DEFERRED_TOKEN;
+    active_count--;
+    return true;
+}
+
+void deferred_exec_task(void) {
+    if (!active_count) {
+        return;
+    }
+    uint32_t now = timer_read32();
+    if (!is_due(next_trigger, now)) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < DEFERRED_EXEC_MAX_TASKS; i++) {
+        deferred_executor_t *executor = &executors[i];
+        if (executor->token == INVALID_DEFERRED_TOKEN || !is_due(executor->trigger_time, now)) {
+            continue;
+        }
+        deferred_token token = executor->token;
+        uint32_t       delay = executor->callback(executor->trigger_time, executor->cb_arg);
+        // The callback may have cancelled or rescheduled itself
+        if (executor->token != token || !is_due(executor->trigger_time, now)) {
+            continue;
+        }
+        if (delay) {
+            // Keep the period, unless we've fallen behind by more than one
+            uint32_t trigger_time = executor->trigger_time + delay;
+            executor->trigger_time = is_due(trigger_time, now) ? now + delay : trigger_time;
+        } else {
+            executor->token = INVALID_DEFERRED_TOKEN;
+            active_count--;
+        }
+    }
+
+    // Find the earliest deadline left
+    bool first = true;
+    for (uint8_t i = 0; i < DEFERRED_EXEC_MAX_TASKS; i++) {
+        if (executors[i].token != INVALID_DEFERRED_TOKEN && (first || is_due(executors[i].trigger_time, next_trigger))) {
+            next_trigger = executors[i].trigger_time;
+            first        = false;
+        }
+    }
+}
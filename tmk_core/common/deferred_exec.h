@@ -0,0 +1,56 @@
+/* Copyright 2020 QMK
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Deferred execution
+ *
+ * Enable with DEFERRED_EXEC_ENABLE = yes in rules.mk. Instead of checking a
+ * timer on every scan, a feature registers a callback to run once a number of
+ * milliseconds have passed. deferred_exec_task() is called from
+ * keyboard_task(), and only does more than one comparison when the earliest
+ * deadline has passed.
+ *
+ * The callback gets the time it was due at, and returns how many milliseconds
+ * later it wants to run again, or 0 to be removed.
+ */
+
+#ifndef DEFERRED_EXEC_MAX_TASKS
+#    define DEFERRED_EXEC_MAX_TASKS 8
+#endif
+
+typedef uint8_t deferred_token;
+#define INVALID_DEFERRED_TOKEN 0
+
+typedef uint32_t (*deferred_exec_callback)(uint32_t trigger_time, void *cb_arg);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Returns INVALID_DEFERRED_TOKEN if all DEFERRED_EXEC_MAX_TASKS slots are in use */
+deferred_token defer_exec(uint32_t delay_ms, deferred_exec_callback callback, void *cb_arg);
+/* Moves the deadline to delay_ms from now, returns false if the callback already ran for good */
+bool extend_deferred_exec(deferred_token token, uint32_t delay_ms);
+bool cancel_deferred_exec(deferred_token token);
+void deferred_exec_task(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,8 +1,10 @@
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include "eeprom.h"
 #include "eeconfig.h"
 #include "action_layer.h"
+#include "timer.h"
 
 #ifdef STM32_EEPROM_ENABLE
 #    include <hal.h>
@@ -17,6 +19,142 @@
 #    include "haptic.h"
 #endif
 
+#ifdef DYNAMIC_KEYMAP_ENABLE
+#    include "dynamic_keymap.h"
+#endif
+
+#ifdef EECONFIG_WRITE_DELAY
+/* Write-back cache of the eeconfig area
+ *
+ * Updates only change the cached copy and mark the bytes dirty. Once nothing
+ * has been written for EECONFIG_WRITE_DELAY milliseconds, eeconfig_task()
+ * writes the dirty bytes back one at a time, so holding down RGB_HUI or
+ * BL_INC doesn't write to the EEPROM on every step.
+ *
+ * Code that reads or writes the EECONFIG_ addresses with eeprom_* directly
+ * bypasses the cache, so it is only enabled when EECONFIG_WRITE_DELAY is set.
+ */
+static uint8_t  eeconfig_cache[EECONFIG_SIZE];
+static uint8_t  eeconfig_dirty[(EECONFIG_SIZE + 7) / 8];
+static bool     eeconfig_cache_valid = false;
+static bool     eeconfig_pending     = false;
+static uint16_t eeconfig_last_write  = 0;
+
+static void eeconfig_cache_load(void) {
+    if (!eeconfig_cache_valid) {
+        eeprom_read_block(eeconfig_cache, (const void *)0, EECONFIG_SIZE);
+        memset(eeconfig_dirty, 0, sizeof(eeconfig_dirty));
+        eeconfig_pending     = false;
+        eeconfig_cache_valid = true;
+    }
+}
+
+// Forget the cache, used when the EEPROM is changed behind its back
+static void eeconfig_cache_invalidate(void) {
+    eeconfig_cache_valid = false;
+    eeconfig_pending     = false;
+}
+
+/** \brief Read from the eeconfig area, including updates that haven't been written yet
+ */
+void eeconfig_read_block(void *buf, const void *addr, size_t len) {
+    uintptr_t offset = (uintptr_t)addr;
+    if (offset + len > EECONFIG_SIZE) {
+        eeprom_read_block(buf, addr, len);
+        return;
+    }
+    eeconfig_cache_load();
+    memcpy(buf, &eeconfig_cache[offset], len);
+}
+
+/** \brief Update the eeconfig area, the EEPROM is written later by eeconfig_task()
+ */
+void eeconfig_update_block(const void *buf, void *addr, size_t len) {
+    uintptr_t      offset = (uintptr_t)addr;
+    const uint8_t *src    = (const uint8_t *)buf;
+    if (offset + len > EECONFIG_SIZE) {
+        eeprom_update_block(buf, addr, len);
+        return;
+    }
+    eeconfig_cache_load();
+    for (; len; len--, offset++, src++) {
+        if (eeconfig_cache[offset] != *src) {
+            eeconfig_cache[offset] = *src;
+            eeconfig_dirty[offset / 8] |= 1 << (offset % 8);
+            eeconfig_pending = true;
+        }
+    }
+    eeconfig_last_write = timer_read();
+}
+
+// Writes back a single dirty byte, returns false if there was none
+static bool eeconfig_write_back(void) {
+    for (uint8_t offset = 0; offset < EECONFIG_SIZE; offset++) {
+        if (eeconfig_dirty[offset / 8] & (1 << (offset % 8))) {
+            eeconfig_dirty[offset / 8] &= ~(1 << (offset % 8));
+            eeprom_update_byte((uint8_t *)(uintptr_t)offset, eeconfig_cache[offset]);
+            return true;
+        }
+    }
+    eeconfig_pending = false;
+    return false;
+}
+
+/** \brief Write all pending updates to the EEPROM right away
+ *
+ * Called before suspending or jumping to the bootloader.
+ */
+void eeconfig_flush(void) {
+    while (eeconfig_pending && eeconfig_write_back()) {
+    }
+}
+
+/** \brief Write back pending updates once they have settled
+ *
+ * Called from keyboard_task(), writes at most one byte per call.
+ */
+void eeconfig_task(void) {
+    if (eeconfig_pending && timer_elapsed(eeconfig_last_write) >= EECONFIG_WRITE_DELAY) {
+        eeconfig_write_back();
+    }
+}
+#else
+static inline void eeconfig_cache_invalidate(void) {}
+
+/** \brief Read from the eeconfig area
+ */
+void eeconfig_read_block(void *buf, const void *addr, size_t len) { eeprom_read_block(buf, addr, len); }
+
+/** \brief Update the eeconfig area
+ */
+void eeconfig_update_block(const void *buf, void *addr, size_t len) { eeprom_update_block(buf, addr, len); }
+
+void eeconfig_flush(void) {}
+void eeconfig_task(void) {}
+#endif
+
+static inline uint8_t eeconfig_read_u8(const uint8_t *addr) {
+    uint8_t val;
+    eeconfig_read_block(&val, addr, sizeof(val));
+    return val;
+}
+
+static inline uint16_t eeconfig_read_u16(const uint16_t *addr) {
+    uint16_t val;
+    eeconfig_read_block(&val, addr, sizeof(val));
+    return val;
+}
+
+static inline uint32_t eeconfig_read_u32(const uint32_t *addr) {
+    uint32_t val;
+    eeconfig_read_block(&val, addr, sizeof(val));
+    return val;
+}
+
+static inline void eeconfig_update_u8(uint8_t *addr, uint8_t val) { eeconfig_update_block(&val, addr, sizeof(val)); }
+static inline void eeconfig_update_u16(uint16_t *addr, uint16_t val) { eeconfig_update_block(&val, addr, sizeof(val)); }
+static inline void eeconfig_update_u32(uint32_t *addr, uint32_t val) { eeconfig_update_block(&val, addr, sizeof(val)); }
+
 /** \brief eeconfig enable
  *
  * FIXME: needs doc
@@ -37,6 +175,10 @@ __attribute__((weak)) void eeconfig_init_kb(void) {
  * FIXME: needs doc
  */
 void eeconfig_init_quantum(void) {
+    eeconfig_cache_invalidate();
+#ifdef DYNAMIC_KEYMAP_ENABLE
+    dynamic_keymap_cache_invalidate();
+#endif
 #ifdef STM32_EEPROM_ENABLE
     EEPROM_Erase();
 #endif
@@ -91,132 +233,133 @@ void eeconfig_init(void) { eeconfig_init_quantum(); }
  *
  * FIXME: needs doc
  */
-void eeconfig_enable(void) { eeprom_update_word(EECONFIG_MAGIC, EECONFIG_MAGIC_NUMBER); }
+void eeconfig_enable(void) { eeconfig_update_u16(EECONFIG_MAGIC, EECONFIG_MAGIC_NUMBER); }
 
 /** \brief eeconfig disable
  *
  * FIXME: needs doc
  */
 void eeconfig_disable(void) {
+    eeconfig_cache_invalidate();
 #ifdef STM32_EEPROM_ENABLE
     EEPROM_Erase();
 #endif
 #if defined(EEPROM_DRIVER)
     eeprom_driver_erase();
 #endif
-    eeprom_update_word(EECONFIG_MAGIC, EECONFIG_MAGIC_NUMBER_OFF);
+    eeconfig_update_u16(EECONFIG_MAGIC, EECONFIG_MAGIC_NUMBER_OFF);
 }
 
 /** \brief eeconfig is enabled
  *
  * FIXME: needs doc
  */
-bool eeconfig_is_enabled(void) { return (eeprom_read_word(EECONFIG_MAGIC) == EECONFIG_MAGIC_NUMBER); }
+bool eeconfig_is_enabled(void) { return (eeconfig_read_u16(EECONFIG_MAGIC) == EECONFIG_MAGIC_NUMBER); }
 
 /** \brief eeconfig is disabled
  *
  * FIXME: needs doc
  */
-bool eeconfig_is_disabled(void) { return (eeprom_read_word(EECONFIG_MAGIC) == EECONFIG_MAGIC_NUMBER_OFF); }
+bool eeconfig_is_disabled(void) { return (eeconfig_read_u16(EECONFIG_MAGIC) == EECONFIG_MAGIC_NUMBER_OFF); }
 
 /** \brief eeconfig read debug
  *
  * FIXME: needs doc
  */
-uint8_t eeconfig_read_debug(void) { return eeprom_read_byte(EECONFIG_DEBUG); }
+uint8_t eeconfig_read_debug(void) { return eeconfig_read_u8(EECONFIG_DEBUG); }
 /** \brief eeconfig update debug
  *
  * FIXME: needs doc
  */
-void eeconfig_update_debug(uint8_t val) { eeprom_update_byte(EECONFIG_DEBUG, val); }
+void eeconfig_update_debug(uint8_t val) { eeconfig_update_u8(EECONFIG_DEBUG, val); }
 
 /** \brief eeconfig read default layer
  *
  * FIXME: needs doc
  */
-uint8_t eeconfig_read_default_layer(void) { return eeprom_read_byte(EECONFIG_DEFAULT_LAYER); }
+uint8_t eeconfig_read_default_layer(void) { return eeconfig_read_u8(EECONFIG_DEFAULT_LAYER); }
 /** \brief eeconfig update default layer
  *
  * FIXME: needs doc
  */
-void eeconfig_update_default_layer(uint8_t val) { eeprom_update_byte(EECONFIG_DEFAULT_LAYER, val); }
+void eeconfig_update_default_layer(uint8_t val) { eeconfig_update_u8(EECONFIG_DEFAULT_LAYER, val); }
 
 /** \brief eeconfig read keymap
  *
  * FIXME: needs doc
  */
-uint16_t eeconfig_read_keymap(void) { return (eeprom_read_byte(EECONFIG_KEYMAP_LOWER_BYTE) | (eeprom_read_byte(EECONFIG_KEYMAP_UPPER_BYTE) << 8)); }
+uint16_t eeconfig_read_keymap(void) { return (eeconfig_read_u8(EECONFIG_KEYMAP_LOWER_BYTE) | (eeconfig_read_u8(EECONFIG_KEYMAP_UPPER_BYTE) << 8)); }
 /** \brief eeconfig update keymap
  *
  * FIXME: needs doc
  */
 void eeconfig_update_keymap(uint16_t val) {
-    eeprom_update_byte(EECONFIG_KEYMAP_LOWER_BYTE, val & 0xFF);
-    eeprom_update_byte(EECONFIG_KEYMAP_UPPER_BYTE, (val >> 8) & 0xFF);
+    eeconfig_update_u8(EECONFIG_KEYMAP_LOWER_BYTE, val & 0xFF);
+    eeconfig_update_u8(EECONFIG_KEYMAP_UPPER_BYTE, (val >> 8) & 0xFF);
 }
 
 /** \brief eeconfig read backlight
  *
  * FIXME: needs doc
  */
-uint8_t eeconfig_read_backlight(void) { return eeprom_read_byte(EECONFIG_BACKLIGHT); }
+uint8_t eeconfig_read_backlight(void) { return eeconfig_read_u8(EECONFIG_BACKLIGHT); }
 /** \brief eeconfig update backlight
  *
  * FIXME: needs doc
  */
-void eeconfig_update_backlight(uint8_t val) { eeprom_update_byte(EECONFIG_BACKLIGHT, val); }
+void eeconfig_update_backlight(uint8_t val) { eeconfig_update_u8(EECONFIG_BACKLIGHT, val); }
 
 /** \brief eeconfig read audio
  *
  * FIXME: needs doc
  */
-uint8_t eeconfig_read_audio(void) { return eeprom_read_byte(EECONFIG_AUDIO); }
+uint8_t eeconfig_read_audio(void) { return eeconfig_read_u8(EECONFIG_AUDIO); }
 /** \brief eeconfig update audio
  *
  * FIXME: needs doc
  */
-void eeconfig_update_audio(uint8_t val) { eeprom_update_byte(EECONFIG_AUDIO, val); }
+void eeconfig_update_audio(uint8_t val) { eeconfig_update_u8(EECONFIG_AUDIO, val); }
 
 /** \brief eeconfig read kb
  *
  * FIXME: needs doc
  */
-uint32_t eeconfig_read_kb(void) { return eeprom_read_dword(EECONFIG_KEYBOARD); }
+uint32_t eeconfig_read_kb(void) { return eeconfig_read_u32(EECONFIG_KEYBOARD); }
 /** \brief eeconfig update kb
  *
  * FIXME: needs doc
  */
-void eeconfig_update_kb(uint32_t val) { eeprom_update_dword(EECONFIG_KEYBOARD, val); }
+void eeconfig_update_kb(uint32_t val) { eeconfig_update_u32(EECONFIG_KEYBOARD, val); }
 
 /** \brief eeconfig read user
  *
  * FIXME: needs doc
  */
-uint32_t eeconfig_read_user(void) { return eeprom_read_dword(EECONFIG_USER); }
+uint32_t eeconfig_read_user(void) { return eeconfig_read_u32(EECONFIG_USER); }
 /** \brief eeconfig update user
  *
  * FIXME: needs doc
  */
-void eeconfig_update_user(uint32_t val) { eeprom_update_dword(EECONFIG_USER, val); }
+void eeconfig_update_user(uint32_t val) { eeconfig_update_u32(EECONFIG_USER, val); }
 
 /** \brief eeconfig read haptic
  *
  * FIXME: needs doc
  */
-uint32_t eeconfig_read_haptic(void) { return eeprom_read_dword(EECONFIG_HAPTIC); }
+uint32_t eeconfig_read_haptic(void) { return eeconfig_read_u32(EECONFIG_HAPTIC); }
 /** \brief eeconfig update haptic
  *
  * FIXME: needs doc
  */
-void eeconfig_update_haptic(uint32_t val) { eeprom_update_dword(EECONFIG_HAPTIC, val); }
+void eeconfig_update_haptic(uint32_t val) { eeconfig_update_u32(EECONFIG_HAPTIC, val); }
 
 /** \brief eeconfig read split handedness
  *
  * FIXME: needs doc
  */
-bool eeconfig_read_handedness(void) { return !!eeprom_read_byte(EECONFIG_HANDEDNESS); }
+bool eeconfig_read_handedness(void) { return !!eeconfig_read_u8(EECONFIG_HANDEDNESS); }
 /** \brief eeconfig update split handedness
  *
  * FIXME: needs doc
  */
-void eeconfig_update_handedness(bool val) { eeprom_update_byte(EECONFIG_HANDEDNESS, !!val); }
+void eeconfig_update_handedness(bool val) { eeconfig_update_u8(EECONFIG_HANDEDNESS, !!val); }
@@ -19,6 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifndef EECONFIG_MAGIC_NUMBER
 #    define EECONFIG_MAGIC_NUMBER (uint16_t)0xFEEC
@@ -49,6 +50,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define EECONFIG_KEYMAP_UPPER_BYTE (uint8_t *)33
 // Size of EEPROM being used, other code can refer to this for available EEPROM
 #define EECONFIG_SIZE 34
+
+// If defined, updates are cached and written to the EEPROM once nothing has
+// changed for this many milliseconds, see eeconfig.c
+// #define EECONFIG_WRITE_DELAY 1000
+
 /* debug bit */
 #define EECONFIG_DEBUG_ENABLE (1 << 0)
 #define EECONFIG_DEBUG_MATRIX (1 << 1)
@@ -67,6 +73,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define EECONFIG_KEYMAP_LOWER_BYTE EECONFIG_KEYMAP
 
+void eeconfig_read_block(void *buf, const void *addr, size_t len);
+void eeconfig_update_block(const void *buf, void *addr, size_t len);
+void eeconfig_flush(void);
+void eeconfig_task(void);
+
 bool eeconfig_is_enabled(void);
 bool eeconfig_is_disabled(void);
 
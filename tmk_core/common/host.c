@@ -21,6 +21,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "host.h"
 #include "util.h"
 #include "debug.h"
+#include "scan_profile.h"
 
 #ifdef NKRO_ENABLE
 #    include "keycode_config.h"
@@ -62,7 +63,9 @@ void host_keyboard_send(report_keyboard_t *report) {
         report->report_id = REPORT_ID_KEYBOARD;
 #endif
     }
+    SCAN_PROFILE_BEGIN(PROFILE_USB_SEND);
     (*driver->send_keyboard)(report);
+    SCAN_PROFILE_END(PROFILE_USB_SEND);
 
     if (debug_keyboard) {
         dprint("keyboard_report: ");
@@ -30,6 +30,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "sendchar.h"
 #include "eeconfig.h"
 #include "action_layer.h"
+#include "scan_profile.h"
 #ifdef BACKLIGHT_ENABLE
 #    include "backlight.h"
 #endif
@@ -95,9 +96,18 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifdef DIP_SWITCH_ENABLE
 #    include "dip_switch.h"
 #endif
+#ifdef DYNAMIC_KEYMAP_ENABLE
+#    include "dynamic_keymap.h"
+#endif
+#ifdef DEFERRED_EXEC_ENABLE
+#    include "deferred_exec.h"
+#endif
 
+#if defined(SCAN_PROFILE_ENABLE)
+// The profiler keeps track of the scan rate too
+#    define matrix_scan_perf_task() scan_profile_task()
+#elif defined(DEBUG_MATRIX_SCAN_RATE)
 // Only enable this if console is enabled to print to
-#if defined(DEBUG_MATRIX_SCAN_RATE)
 static uint32_t matrix_timer           = 0;
 static uint32_t matrix_scan_count      = 0;
 static uint32_t last_matrix_scan_count = 0;
@@ -123,18 +133,26 @@ uint32_t get_matrix_scan_rate(void) { return last_matrix_scan_count; }
 
 #ifdef MATRIX_HAS_GHOST
 extern const uint16_t keymaps[][MATRIX_ROWS][MATRIX_COLS];
-static matrix_row_t   get_real_keys(uint8_t row, matrix_row_t rowdata) {
-    matrix_row_t out = 0;
-    for (uint8_t col = 0; col < MATRIX_COLS; col++) {
-        // read each key in the row data and check if the keymap defines it as a real key
-        if (pgm_read_byte(&keymaps[0][row][col]) && (rowdata & (1 << col))) {
-            // this creates new row data, if a key is defined in the keymap, it will be set here
-            out |= 1 << col;
+static matrix_row_t   real_keys[MATRIX_ROWS];
+
+/** \brief Find the keys that are defined in the keymap
+ *
+ * Blanks in the base layer can't be pressed, so they are left out of the
+ * ghost checks. Done once at init, rather than on every matrix change.
+ */
+static void init_real_keys(void) {
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        real_keys[row] = 0;
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            if (pgm_read_word(&keymaps[0][row][col])) {
+                real_keys[row] |= (matrix_row_t)1 << col;
+            }
         }
     }
-    return out;
 }
 
+static inline matrix_row_t get_real_keys(uint8_t row, matrix_row_t rowdata) { return rowdata & real_keys[row]; }
+
 static inline bool popcount_more_than_one(matrix_row_t rowdata) {
     rowdata &= rowdata - 1;  // if there are less than two bits (keys) set, rowdata will become zero
     return rowdata;
@@ -166,6 +184,43 @@ static inline bool has_ghost_in_row(uint8_t row, matrix_row_t rowdata) {
 
 #endif
 
+#ifdef KEYBOARD_EVENT_QUEUE
+/** \brief Queue up the matrix changes of a scan
+ *
+ * Every change is stamped with the time of the scan, in row and column order,
+ * so keys that went down together are seen together by the tapping code.
+ * Changes that don't fit into the queue are left for the next scan.
+ */
+static uint8_t keyboard_queue_events(matrix_row_t matrix_prev[], keyevent_t events[]) {
+    uint16_t time  = timer_read() | 1; /* time should not be 0 */
+    uint8_t  count = 0;
+
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+        matrix_row_t matrix_row    = matrix_get_row(r);
+        matrix_row_t matrix_change = matrix_row ^ matrix_prev[r];
+        if (matrix_change) {
+#    ifdef MATRIX_HAS_GHOST
+            if (has_ghost_in_row(r, matrix_row)) {
+                continue;
+            }
+#    endif
+            if (debug_matrix) matrix_print();
+            matrix_row_t col_mask = 1;
+            for (uint8_t c = 0; c < MATRIX_COLS; c++, col_mask <<= 1) {
+                if (matrix_change & col_mask) {
+                    if (count >= KEYBOARD_EVENT_QUEUE_SIZE) {
+                        return count;
+                    }
+                    events[count++] = (keyevent_t){.key = (keypos_t){.row = r, .col = c}, .pressed = (matrix_row & col_mask), .time = time};
+                    matrix_prev[r] ^= col_mask;
+                }
+            }
+        }
+    }
+    return count;
+}
+#endif
+
 void disable_jtag(void) {
 // To use PF4-7 (PC2-5 on ATmega32A), disable JTAG by writing JTD bit twice within four cycles.
 #if (defined(__AVR_AT90USB646__) || defined(__AVR_AT90USB647__) || defined(__AVR_AT90USB1286__) || defined(__AVR_AT90USB1287__) || defined(__AVR_ATmega16U4__) || defined(__AVR_ATmega32U4__))
@@ -254,6 +309,39 @@ __attribute__((weak)) void housekeeping_task_kb(void) {}
  */
 __attribute__((weak)) void housekeeping_task_user(void) {}
 
+/** \brief idle_sleep_allowed_kb
+ *
+ * Override this function to keep the main loop from sleeping while the matrix is idle,
+ * e.g. when something has to be polled that can't wake up the MCU.
+ * This is specific to keyboard-level functionality.
+ */
+__attribute__((weak)) bool idle_sleep_allowed_kb(void) { return idle_sleep_allowed_user(); }
+
+/** \brief idle_sleep_allowed_user
+ *
+ * Override this function to keep the main loop from sleeping while the matrix is idle.
+ * This is specific to user/keymap-level functionality.
+ */
+__attribute__((weak)) bool idle_sleep_allowed_user(void) { return true; }
+
+/** \brief keyboard_idle_sleep
+ *
+ * Called by the main loop after keyboard_task(). While the matrix is idle, this waits for a
+ * key press for up to MATRIX_IDLE_WAIT ms, unless a feature that is polled vetoes it.
+ */
+void keyboard_idle_sleep(void) {
+#ifdef MATRIX_IDLE_TIMEOUT
+#    if defined(ENCODER_ENABLE) || defined(POINTING_DEVICE_ENABLE)
+    // These are only ever polled, sleeping would lose their input
+    return;
+#    else
+    if (matrix_is_idle() && idle_sleep_allowed_kb()) {
+        matrix_idle_wait();
+    }
+#    endif
+#endif
+}
+
 /** \brief keyboard_init
  *
  * FIXME: needs doc
@@ -261,6 +349,9 @@ __attribute__((weak)) void housekeeping_task_user(void) {}
 void keyboard_init(void) {
     timer_init();
     matrix_init();
+#ifdef MATRIX_HAS_GHOST
+    init_real_keys();
+#endif
 #ifdef VIA_ENABLE
     via_init();
 #endif
@@ -284,6 +375,9 @@ void keyboard_init(void) {
 #else
     magic();
 #endif
+#ifdef DYNAMIC_KEYMAP_ENABLE
+    dynamic_keymap_init();
+#endif
 #ifdef BACKLIGHT_ENABLE
     backlight_init();
 #endif
@@ -310,7 +404,7 @@ void keyboard_init(void) {
     dip_switch_init();
 #endif
 
-#if defined(DEBUG_MATRIX_SCAN_RATE) && defined(CONSOLE_ENABLE)
+#if (defined(DEBUG_MATRIX_SCAN_RATE) || defined(SCAN_PROFILE_ENABLE)) && defined(CONSOLE_ENABLE)
     debug_enable = true;
 #endif
 
@@ -331,64 +425,93 @@ void keyboard_init(void) {
  */
 void keyboard_task(void) {
     static matrix_row_t matrix_prev[MATRIX_ROWS];
-    static uint8_t      led_status    = 0;
-    matrix_row_t        matrix_row    = 0;
-    matrix_row_t        matrix_change = 0;
-#ifdef QMK_KEYS_PER_SCAN
+    static uint8_t      led_status = 0;
+#ifdef KEYBOARD_EVENT_QUEUE
     uint8_t keys_processed = 0;
+#else
+    matrix_row_t matrix_row    = 0;
+    matrix_row_t matrix_change = 0;
+#    ifdef QMK_KEYS_PER_SCAN
+    uint8_t keys_processed = 0;
+#    endif
 #endif
 
+    SCAN_PROFILE_BEGIN(PROFILE_KEYBOARD_TASK);
+
     housekeeping_task_kb();
     housekeeping_task_user();
 
+    SCAN_PROFILE_BEGIN(PROFILE_MATRIX_SCAN);
 #if defined(OLED_DRIVER_ENABLE) && !defined(OLED_DISABLE_TIMEOUT)
     uint8_t ret = matrix_scan();
 #else
     matrix_scan();
 #endif
+    SCAN_PROFILE_END(PROFILE_MATRIX_SCAN);
+
+#ifdef DEFERRED_EXEC_ENABLE
+    // Timeouts are handled before this scan's key events, like those checked in matrix_scan_quantum()
+    deferred_exec_task();
+#endif
 
     if (should_process_keypress()) {
+#ifdef KEYBOARD_EVENT_QUEUE
+        keyevent_t events[KEYBOARD_EVENT_QUEUE_SIZE];
+        keys_processed = keyboard_queue_events(matrix_prev, events);
+        for (uint8_t i = 0; i < keys_processed; i++) {
+            SCAN_PROFILE_BEGIN(PROFILE_ACTION_EXEC);
+            action_exec(events[i]);
+            SCAN_PROFILE_END(PROFILE_ACTION_EXEC);
+        }
+#else
         for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
             matrix_row    = matrix_get_row(r);
             matrix_change = matrix_row ^ matrix_prev[r];
             if (matrix_change) {
-#ifdef MATRIX_HAS_GHOST
+#    ifdef MATRIX_HAS_GHOST
                 if (has_ghost_in_row(r, matrix_row)) {
                     continue;
                 }
-#endif
+#    endif
                 if (debug_matrix) matrix_print();
                 matrix_row_t col_mask = 1;
                 for (uint8_t c = 0; c < MATRIX_COLS; c++, col_mask <<= 1) {
                     if (matrix_change & col_mask) {
+                        SCAN_PROFILE_BEGIN(PROFILE_ACTION_EXEC);
                         action_exec((keyevent_t){
                             .key = (keypos_t){.row = r, .col = c}, .pressed = (matrix_row & col_mask), .time = (timer_read() | 1) /* time should not be 0 */
                         });
+                        SCAN_PROFILE_END(PROFILE_ACTION_EXEC);
                         // record a processed key
                         matrix_prev[r] ^= col_mask;
-#ifdef QMK_KEYS_PER_SCAN
+#    ifdef QMK_KEYS_PER_SCAN
                         // only jump out if we have processed "enough" keys.
                         if (++keys_processed >= QMK_KEYS_PER_SCAN)
-#endif
+#    endif
                             // process a key per task call
                             goto MATRIX_LOOP_END;
                     }
                 }
             }
         }
+#endif
     }
     // call with pseudo tick event when no real key event.
-#ifdef QMK_KEYS_PER_SCAN
+#if defined(QMK_KEYS_PER_SCAN) || defined(KEYBOARD_EVENT_QUEUE)
     // we can get here with some keys processed now.
     if (!keys_processed)
 #endif
+    {
+        SCAN_PROFILE_BEGIN(PROFILE_ACTION_EXEC);
         action_exec(TICK);
+        SCAN_PROFILE_END(PROFILE_ACTION_EXEC);
+    }
 
+#ifndef KEYBOARD_EVENT_QUEUE
 MATRIX_LOOP_END:
+#endif
 
-#ifdef DEBUG_MATRIX_SCAN_RATE
     matrix_scan_perf_task();
-#endif
 
 #if defined(RGBLIGHT_ENABLE)
     rgblight_task();
@@ -409,7 +532,9 @@ MATRIX_LOOP_END:
 #endif
 
 #ifdef OLED_DRIVER_ENABLE
+    SCAN_PROFILE_BEGIN(PROFILE_OLED);
     oled_task();
+    SCAN_PROFILE_END(PROFILE_OLED);
 #    ifndef OLED_DISABLE_TIMEOUT
     // Wake up oled if user is using those fabulous keys!
     if (ret) oled_on();
@@ -459,11 +584,19 @@ MATRIX_LOOP_END:
     joystick_task();
 #endif
 
+#ifdef DYNAMIC_KEYMAP_ENABLE
+    dynamic_keymap_task();
+#endif
+
+    eeconfig_task();
+
     // update LED
     if (led_status != host_keyboard_leds()) {
         led_status = host_keyboard_leds();
         keyboard_set_leds(led_status);
     }
+
+    SCAN_PROFILE_END(PROFILE_KEYBOARD_TASK);
 }
 
 /** \brief keyboard set leds
@@ -48,6 +48,11 @@ static inline bool IS_NOEVENT(keyevent_t event) { return event.time == 0 || (eve
 static inline bool IS_PRESSED(keyevent_t event) { return (!IS_NOEVENT(event) && event.pressed); }
 static inline bool IS_RELEASED(keyevent_t event) { return (!IS_NOEVENT(event) && !event.pressed); }
 
+/* Most key events processed in a single scan with KEYBOARD_EVENT_QUEUE */
+#ifndef KEYBOARD_EVENT_QUEUE_SIZE
+#    define KEYBOARD_EVENT_QUEUE_SIZE 16
+#endif
+
 /* Tick event */
 #define TICK \
     (keyevent_t) { .key = (keypos_t){.row = 255, .col = 255}, .pressed = false, .time = (timer_read() | 1) }
@@ -73,6 +78,11 @@ void keyboard_post_init_user(void);
 void housekeeping_task_kb(void);
 void housekeeping_task_user(void);
 
+/* it runs after keyboard_task() in main loop, and may sleep while the matrix is idle */
+void keyboard_idle_sleep(void);
+bool idle_sleep_allowed_kb(void);
+bool idle_sleep_allowed_user(void);
+
 uint32_t get_matrix_scan_rate(void);
 
 #ifdef __cplusplus
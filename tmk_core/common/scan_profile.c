@@ -0,0 +1,278 @@
+/* Copyright 2020 QMK
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "scan_profile.h"
+#include "timer.h"
+#include "print.h"
+#include "debug.h"
+
+#if defined(__AVR__)
+#    include <avr/io.h>
+#    include <util/atomic.h>
+
+#    if defined(__AVR_ATmega32A__)
+#        define TIMER_PENDING (TIFR & _BV(OCF0))
+#    elif defined(__AVR_ATtiny85__)
+#        define TIMER_PENDING (TIFR & _BV(OCF0A))
+#    else
+#        define TIMER_PENDING (TIFR0 & _BV(OCF0A))
+#    endif
+
+// Combine the millisecond counter with the raw timer0 value, which gives a
+// resolution of 4us at 16MHz. The result wraps, so only differences count.
+uint32_t scan_profile_read(void) {
+    uint32_t ms;
+    uint8_t  raw;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        ms  = timer_count;
+        raw = TIMER_RAW;
+        // timer0 may have wrapped without the interrupt having run yet
+        if (TIMER_PENDING) {
+            ms++;
+            raw = TIMER_RAW;
+        }
+    }
+    return ms * 1000 + (uint32_t)raw * 1000 / TIMER_RAW_TOP;
+}
+
+static inline uint32_t elapsed_us(uint32_t start) { return scan_profile_read() - start; }
+
+#elif defined(PROTOCOL_CHIBIOS)
+#    include <hal.h>
+
+#    if !defined(SCAN_PROFILE_RT_FREQUENCY) && defined(STM32_SYSCLK)
+#        define SCAN_PROFILE_RT_FREQUENCY STM32_SYSCLK
+#    endif
+
+#    if PORT_SUPPORTS_RT && defined(SCAN_PROFILE_RT_FREQUENCY)
+// Use the cycle counter where available
+uint32_t scan_profile_read(void) { return chSysGetRealtimeCounterX(); }
+
+static inline uint32_t elapsed_us(uint32_t start) { return (chSysGetRealtimeCounterX() - start) / (SCAN_PROFILE_RT_FREQUENCY / 1000000); }
+#    else
+// Otherwise fall back to the system tick, which is a lot coarser
+uint32_t scan_profile_read(void) { return (uint32_t)chVTGetSystemTimeX(); }
+
+static inline uint32_t elapsed_us(uint32_t start) { return TIME_I2US((systime_t)(chVTGetSystemTimeX() - (systime_t)start)); }
+#    endif
+
+#else
+// Only millisecond resolution
+uint32_t scan_profile_read(void) { return timer_read32() * 1000; }
+
+static inline uint32_t elapsed_us(uint32_t start) { return scan_profile_read() - start; }
+#endif
+
+typedef struct {
+    uint32_t count;
+    uint32_t total;
+    uint16_t min;
+    uint16_t max;
+    uint16_t histogram[SCAN_PROFILE_BUCKETS];
+} scan_profile_stage_data_t;
+
+static scan_profile_stage_data_t stages[PROFILE_STAGE_COUNT];
+
+static uint32_t scan_count     = 0;
+static uint32_t scan_rate      = 0;
+static uint32_t scan_rate_time = 0;
+#if SCAN_PROFILE_PRINT_INTERVAL > 0
+static uint32_t print_time = 0;
+#endif
+
+/* Bucket 0 and 1 hold 0us and 1us, after that every power of two is split
+ * into two buckets: 2, 3, 4-5, 6-7, 8-11, 12-15, 16-23, ...
+ */
+static uint8_t bucket_index(uint16_t us) {
+    if (us < 2) {
+        return us;
+    }
+    uint8_t msb = 15;
+    while (!(us & (1 << msb))) {
+        msb--;
+    }
+    uint8_t index = msb * 2 + ((us >> (msb - 1)) & 1);
+    return index < SCAN_PROFILE_BUCKETS ? index : SCAN_PROFILE_BUCKETS - 1;
+}
+
+static uint16_t bucket_lower_bound(uint8_t index) {
+    if (index < 2) {
+        return index;
+    }
+    uint8_t msb = index / 2;
+    return (1 << msb) | ((index & 1) << (msb - 1));
+}
+
+// Halve all counts so the histogram keeps following recent behaviour
+static void decay(scan_profile_stage_data_t *data) {
+    data->count = 0;
+    for (uint8_t i = 0; i < SCAN_PROFILE_BUCKETS; i++) {
+        data->histogram[i] /= 2;
+        data->count += data->histogram[i];
+    }
+    data->total /= 2;
+}
+
+void scan_profile_record(scan_profile_stage_t stage, uint32_t start) {
+    uint32_t                   us   = elapsed_us(start);
+    uint16_t                   v    = us > UINT16_MAX ? UINT16_MAX : us;
+    scan_profile_stage_data_t *data = &stages[stage];
+
+    if (data->count == 0 || v < data->min) {
+        data->min = v;
+    }
+    if (v > data->max) {
+        data->max = v;
+    }
+    if (data->total > UINT32_MAX - UINT16_MAX) {
+        decay(data);
+    }
+    data->total += v;
+    data->count++;
+    if (++data->histogram[bucket_index(v)] == UINT16_MAX) {
+        decay(data);
+    }
+}
+
+static uint16_t percentile(const scan_profile_stage_data_t *data, uint8_t percent) {
+    uint32_t threshold = (data->count * percent + 99) / 100;
+    uint32_t sum       = 0;
+    for (uint8_t i = 0; i < SCAN_PROFILE_BUCKETS - 1; i++) {
+        sum += data->histogram[i];
+        if (sum >= threshold) {
+            // Report the upper bound of the bucket, but never more than we have seen
+            uint16_t upper = bucket_lower_bound(i + 1) - 1;
+            return upper < data->max ? upper : data->max;
+        }
+    }
+    return data->max;
+}
+
+void scan_profile_get_stats(scan_profile_stage_t stage, scan_profile_stats_t *stats) {
+    const scan_profile_stage_data_t *data = &stages[stage];
+
+    memset(stats, 0, sizeof(scan_profile_stats_t));
+    if (data->count == 0) {
+        return;
+    }
+    stats->count = data->count;
+    stats->min   = data->min;
+    stats->max   = data->max;
+    stats->mean  = data->total / data->count;
+    stats->p50   = percentile(data, 50);
+    stats->p99   = percentile(data, 99);
+}
+
+void scan_profile_reset(void) {
+    memset(stages, 0, sizeof(stages));
+    scan_count = 0;
+}
+
+uint32_t get_matrix_scan_rate(void) { return scan_rate; }
+
+void scan_profile_print(void) {
+#ifndef NO_DEBUG
+    static const char *names[PROFILE_STAGE_COUNT] = {"task", "matrix", "debounce", "action", "record", "rgb_mtx", "oled", "split", "usb"};
+
+    dprintf("scan rate: %lu/s\n", (unsigned long)scan_rate);
+    dprintf("stage       count   min   p50   p99   max  mean (us)\n");
+    for (uint8_t i = 0; i < PROFILE_STAGE_COUNT; i++) {
+        scan_profile_stats_t stats;
+        scan_profile_get_stats(i, &stats);
+        if (stats.count) {
+            dprintf("%-8s %8lu %5u %5u %5u %5u %5u\n", names[i], (unsigned long)stats.count, stats.min, stats.p50, stats.p99, stats.max, stats.mean);
+        }
+    }
+#endif
+}
+
+/** \brief Called once per keyboard_task() to keep track of the scan rate
+ */
+void scan_profile_task(void) {
+    uint32_t now = timer_read32();
+
+    scan_count++;
+    if (TIMER_DIFF_32(now, scan_rate_time) >= 1000) {
+        scan_rate      = scan_count;
+        scan_count     = 0;
+        scan_rate_time = now;
+    }
+
+#if SCAN_PROFILE_PRINT_INTERVAL > 0
+    if (TIMER_DIFF_32(now, print_time) >= SCAN_PROFILE_PRINT_INTERVAL) {
+        print_time = now;
+        scan_profile_print();
+    }
+#endif
+}
+
+static void write_u16(uint8_t *data, uint16_t value) {
+    data[0] = value >> 8;
+    data[1] = value & 0xFF;
+}
+
+static void write_u32(uint8_t *data, uint32_t value) {
+    write_u16(data, value >> 16);
+    write_u16(data + 2, value & 0xFFFF);
+}
+
+/** \brief Handle a raw HID packet addressed to the profiler
+ *
+ * Packets start with SCAN_PROFILE_RAW_HID_ID and a command, and the reply is
+ * written to the same buffer. All values are big endian, like VIA.
+ *
+ *   get_stage_count: [id, 0x01] -> [id, 0x01, count]
+ *   get_stats:       [id, 0x02, stage] -> [id, 0x02, stage, count(4), min(2), p50(2), p99(2), max(2), mean(2)]
+ *   get_scan_rate:   [id, 0x03] -> [id, 0x03, scans per second(4)]
+ *   reset:           [id, 0x04]
+ *
+ * Returns false if the packet wasn't meant for the profiler.
+ */
+bool scan_profile_raw_hid_receive(uint8_t *data, uint8_t length) {
+    if (length < 19 || data[0] != SCAN_PROFILE_RAW_HID_ID) {
+        return false;
+    }
+
+    switch (data[1]) {
+        case id_scan_profile_get_stage_count:
+            data[2] = PROFILE_STAGE_COUNT;
+            break;
+        case id_scan_profile_get_stats: {
+            scan_profile_stats_t stats;
+            if (data[2] >= PROFILE_STAGE_COUNT) {
+                return false;
+            }
+            scan_profile_get_stats(data[2], &stats);
+            write_u32(&data[3], stats.count);
+            write_u16(&data[7], stats.min);
+            write_u16(&data[9], stats.p50);
+            write_u16(&data[11], stats.p99);
+            write_u16(&data[13], stats.max);
+            write_u16(&data[15], stats.mean);
+            break;
+        }
+        case id_scan_profile_get_scan_rate:
+            write_u32(&data[2], scan_rate);
+            break;
+        case id_scan_profile_reset:
+            scan_profile_reset();
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
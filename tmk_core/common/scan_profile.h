@@ -0,0 +1,97 @@
+/* Copyright 2020 QMK
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Per-stage timing of the main loop
+ *
+ * Enable with SCAN_PROFILE_ENABLE = yes in rules.mk. Every instrumented stage
+ * keeps a histogram of how long it took, in microseconds, along with the
+ * minimum, maximum and mean. The statistics can be printed to the console, or
+ * queried over raw HID with scan_profile_raw_hid_receive().
+ */
+
+typedef enum {
+    PROFILE_KEYBOARD_TASK,
+    PROFILE_MATRIX_SCAN,
+    PROFILE_DEBOUNCE,
+    PROFILE_ACTION_EXEC,
+    PROFILE_PROCESS_RECORD,
+    PROFILE_RGB_MATRIX,
+    PROFILE_OLED,
+    PROFILE_TRANSPORT,
+    PROFILE_USB_SEND,
+    PROFILE_STAGE_COUNT,
+} scan_profile_stage_t;
+
+typedef struct {
+    uint32_t count;
+    uint16_t min;
+    uint16_t max;
+    uint16_t mean;
+    uint16_t p50;
+    uint16_t p99;
+} scan_profile_stats_t;
+
+// Buckets are half an octave wide, so percentiles are accurate to within 50%.
+// The last bucket collects everything from 3072us up, use max for those.
+#ifndef SCAN_PROFILE_BUCKETS
+#    define SCAN_PROFILE_BUCKETS 24
+#endif
+
+// How often the statistics are printed to the console, 0 to disable
+#ifndef SCAN_PROFILE_PRINT_INTERVAL
+#    define SCAN_PROFILE_PRINT_INTERVAL 10000
+#endif
+
+// First byte of raw HID packets handled by scan_profile_raw_hid_receive()
+#ifndef SCAN_PROFILE_RAW_HID_ID
+#    define SCAN_PROFILE_RAW_HID_ID 0xF0
+#endif
+
+enum scan_profile_raw_hid_command {
+    id_scan_profile_get_stage_count = 0x01,
+    id_scan_profile_get_stats       = 0x02,
+    id_scan_profile_get_scan_rate   = 0x03,
+    id_scan_profile_reset           = 0x04,
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t scan_profile_read(void);
+void     scan_profile_record(scan_profile_stage_t stage, uint32_t start);
+void     scan_profile_get_stats(scan_profile_stage_t stage, scan_profile_stats_t *stats);
+void     scan_profile_reset(void);
+void     scan_profile_task(void);
+void     scan_profile_print(void);
+bool     scan_profile_raw_hid_receive(uint8_t *data, uint8_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef SCAN_PROFILE_ENABLE
+#    define SCAN_PROFILE_BEGIN(stage) uint32_t scan_profile_start_##stage = scan_profile_read()
+#    define SCAN_PROFILE_END(stage) scan_profile_record(stage, scan_profile_start_##stage)
+#else
+#    define SCAN_PROFILE_BEGIN(stage)
+#    define SCAN_PROFILE_END(stage)
+#endif
@@ -253,6 +253,7 @@ int main(void) {
 #endif
 
         keyboard_task();
+        keyboard_idle_sleep();
 #ifdef CONSOLE_ENABLE
         console_task();
 #endif
@@ -27,6 +27,7 @@
 
 #include <ch.h>
 #include <hal.h>
+#include <string.h>
 
 #include "usb_main.h"
 
@@ -79,6 +80,165 @@ report_mouse_t mouse_report_blank = {0};
 uint8_t extra_report_blank[3] = {0};
 #endif /* EXTRAKEY_ENABLE */
 
+/* ---------------------------------------------------------
+ *                   HID report queues
+ * ---------------------------------------------------------
+ */
+
+/* Reports are queued per IN endpoint and sent one after another from the
+ * endpoint's IN callback, so send_keyboard() and friends only block when the
+ * queue is full. The report at the head of the queue is the one the USB
+ * driver is transmitting, and stays put until the transfer completes.
+ */
+
+#ifndef USB_REPORT_QUEUE_SIZE
+#    define USB_REPORT_QUEUE_SIZE 8
+#endif
+
+#if USB_REPORT_QUEUE_SIZE > 255
+#    error USB_REPORT_QUEUE_SIZE must be less than 256
+#endif
+
+typedef struct {
+    uint8_t size;
+    uint8_t data[sizeof(report_keyboard_t)];
+} usb_report_t;
+
+typedef struct {
+    usbep_t            ep;
+    bool               in_flight;
+    uint8_t            head;
+    uint8_t            count;
+    thread_reference_t waiting;
+    usb_report_t       reports[USB_REPORT_QUEUE_SIZE];
+} usb_report_queue_t;
+
+_Static_assert(sizeof(report_mouse_t) <= sizeof(report_keyboard_t), "report_mouse_t doesn't fit the report queue");
+_Static_assert(sizeof(report_extra_t) <= sizeof(report_keyboard_t), "report_extra_t doesn't fit the report queue");
+
+#ifndef KEYBOARD_SHARED_EP
+static usb_report_queue_t kbd_report_queue = {.ep = KEYBOARD_IN_EPNUM};
+#endif
+#if defined(MOUSE_ENABLE) && !defined(MOUSE_SHARED_EP)
+static usb_report_queue_t mouse_report_queue = {.ep = MOUSE_IN_EPNUM};
+#endif
+#ifdef SHARED_EP_ENABLE
+static usb_report_queue_t shared_report_queue = {.ep = SHARED_IN_EPNUM};
+#endif
+
+static usb_report_queue_t *report_queue(usbep_t ep) {
+#ifndef KEYBOARD_SHARED_EP
+    if (ep == KEYBOARD_IN_EPNUM) {
+        return &kbd_report_queue;
+    }
+#endif
+#if defined(MOUSE_ENABLE) && !defined(MOUSE_SHARED_EP)
+    if (ep == MOUSE_IN_EPNUM) {
+        return &mouse_report_queue;
+    }
+#endif
+#ifdef SHARED_EP_ENABLE
+    if (ep == SHARED_IN_EPNUM) {
+        return &shared_report_queue;
+    }
+#endif
+    return NULL;
+}
+
+static inline usb_report_t *report_queue_tail(usb_report_queue_t *queue) { return &queue->reports[(queue->head + queue->count - 1) % USB_REPORT_QUEUE_SIZE]; }
+
+/* Returns the newest report that hasn't been handed to the USB driver yet,
+ * it may still be modified. Called from locked state.
+ */
+static usb_report_t *report_queue_pending_tail(usb_report_queue_t *queue) {
+    if (queue->count == 0 || (queue->count == 1 && queue->in_flight)) {
+        return NULL;
+    }
+    return report_queue_tail(queue);
+}
+
+/* Starts transmitting the head of the queue if the endpoint is free.
+ * Called from locked state.
+ */
+static void report_queue_kick(USBDriver *usbp, usb_report_queue_t *queue) {
+    if (queue->in_flight || queue->count == 0 || usbGetTransmitStatusI(usbp, queue->ep)) {
+        return;
+    }
+    usb_report_t *report = &queue->reports[queue->head];
+    queue->in_flight     = true;
+    usbStartTransmitI(usbp, queue->ep, report->data, report->size);
+}
+
+/* Drops all queued reports and wakes up a thread waiting for room.
+ * Called from locked state, e.g. on USB reset.
+ */
+static void report_queue_clear(usb_report_queue_t *queue) {
+    queue->in_flight = false;
+    queue->head      = 0;
+    queue->count     = 0;
+    osalThreadResumeI(&queue->waiting, MSG_RESET);
+}
+
+static void report_queues_clear(void) {
+#ifndef KEYBOARD_SHARED_EP
+    report_queue_clear(&kbd_report_queue);
+#endif
+#if defined(MOUSE_ENABLE) && !defined(MOUSE_SHARED_EP)
+    report_queue_clear(&mouse_report_queue);
+#endif
+#ifdef SHARED_EP_ENABLE
+    report_queue_clear(&shared_report_queue);
+#endif
+}
+
+/* IN callback of the queued endpoints (called from ISR, unlocked state) */
+static void report_queue_in_cb(USBDriver *usbp, usbep_t ep) {
+    usb_report_queue_t *queue = report_queue(ep);
+    if (!queue) {
+        return;
+    }
+
+    osalSysLockFromISR();
+    /* this may also be the end of a transfer the idle timer started */
+    if (queue->in_flight) {
+        queue->in_flight = false;
+        queue->head      = (queue->head + 1) % USB_REPORT_QUEUE_SIZE;
+        queue->count--;
+        osalThreadResumeI(&queue->waiting, MSG_OK);
+    }
+    report_queue_kick(usbp, queue);
+    osalSysUnlockFromISR();
+}
+
+/* Adds a report to the queue of an endpoint. With drop_duplicate, a report
+ * identical to the last one queued is dropped, as it wouldn't change anything
+ * on the host. When the queue is full this waits for room, at most timeout.
+ * Not callable from ISR, called from locked state.
+ */
+static void report_queue_send(usbep_t ep, const void *data, uint8_t size, bool drop_duplicate, sysinterval_t timeout) {
+    usb_report_queue_t *queue = report_queue(ep);
+
+    if (drop_duplicate && queue->count && report_queue_tail(queue)->size == size && memcmp(report_queue_tail(queue)->data, data, size) == 0) {
+        return;
+    }
+
+    while (queue->count == USB_REPORT_QUEUE_SIZE) {
+        if (osalThreadSuspendTimeoutS(&queue->waiting, timeout) != MSG_OK) {
+            return;
+        }
+        /* USB status might have changed while waiting */
+        if (usbGetDriverStateI(&USB_DRIVER) != USB_ACTIVE) {
+            return;
+        }
+    }
+
+    queue->count++;
+    usb_report_t *report = report_queue_tail(queue);
+    report->size         = size;
+    memcpy(report->data, data, size);
+    report_queue_kick(&USB_DRIVER, queue);
+}
+
 /* ---------------------------------------------------------
  *            Descriptors and USB driver objects
  * ---------------------------------------------------------
@@ -377,6 +537,7 @@ static void usb_event_cb(USBDriver *usbp, usbevent_t event) {
 
         case USB_EVENT_CONFIGURED:
             osalSysLockFromISR();
+            report_queues_clear();
             /* Enable the endpoints specified into the configuration. */
 #ifndef KEYBOARD_SHARED_EP
             usbInitEndpointI(usbp, KEYBOARD_IN_EPNUM, &kbd_ep_config);
@@ -409,6 +570,9 @@ static void usb_event_cb(USBDriver *usbp, usbevent_t event) {
         case USB_EVENT_UNCONFIGURED:
             /* Falls into.*/
         case USB_EVENT_RESET:
+            osalSysLockFromISR();
+            report_queues_clear();
+            osalSysUnlockFromISR();
             for (int i = 0; i < NUM_USB_DRIVERS; i++) {
                 chSysLockFromISR();
                 /* Disconnection event on suspend.*/
@@ -661,11 +825,7 @@ void restart_usb_driver(USBDriver *usbp) {
  */
 /* keyboard IN callback hander (a kbd report has made it IN) */
 #ifndef KEYBOARD_SHARED_EP
-void kbd_in_cb(USBDriver *usbp, usbep_t ep) {
-    /* STUB */
-    (void)usbp;
-    (void)ep;
-}
+void kbd_in_cb(USBDriver *usbp, usbep_t ep) { report_queue_in_cb(usbp, ep); }
 #endif
 
 /* start-of-frame handler
@@ -693,7 +853,8 @@ static void keyboard_idle_timer_cb(void *arg) {
     if (keyboard_idle && keyboard_protocol) {
 #endif /* NKRO_ENABLE */
         /* TODO: are we sure we want the KBD_ENDPOINT? */
-        if (!usbGetTransmitStatusI(usbp, KEYBOARD_IN_EPNUM)) {
+        /* queued reports are newer than an idle repeat */
+        if (!usbGetTransmitStatusI(usbp, KEYBOARD_IN_EPNUM) && report_queue(KEYBOARD_IN_EPNUM)->count == 0) {
             usbStartTransmitI(usbp, KEYBOARD_IN_EPNUM, (uint8_t *)&keyboard_report_sent, KEYBOARD_EPSIZE);
         }
         /* rearm the timer */
@@ -708,7 +869,7 @@ static void keyboard_idle_timer_cb(void *arg) {
 /* LED status */
 uint8_t keyboard_leds(void) { return keyboard_led_state; }
 
-/* prepare and start sending a report IN
+/* queue a report to be sent IN
  * not callable from ISR or locked state */
 void send_keyboard(report_keyboard_t *report) {
     osalSysLock();
@@ -718,41 +879,10 @@ void send_keyboard(report_keyboard_t *report) {
 
 #ifdef NKRO_ENABLE
     if (keymap_config.nkro && keyboard_protocol) { /* NKRO protocol */
-        /* need to wait until the previous packet has made it through */
-        /* can rewrite this using the synchronous API, then would wait
-         * until *after* the packet has been transmitted. I think
-         * this is more efficient */
-        /* busy wait, should be short and not very common */
-        if (usbGetTransmitStatusI(&USB_DRIVER, SHARED_IN_EPNUM)) {
-            /* Need to either suspend, or loop and call unlock/lock during
-             * every iteration - otherwise the system will remain locked,
-             * no interrupts served, so USB not going through as well.
-             * Note: for suspend, need USB_USE_WAIT == TRUE in halconf.h */
-            osalThreadSuspendS(&(&USB_DRIVER)->epc[SHARED_IN_EPNUM]->in_state->thread);
-
-            /* after osalThreadSuspendS returns USB status might have changed */
-            if (usbGetDriverStateI(&USB_DRIVER) != USB_ACTIVE) {
-                goto unlock;
-            }
-        }
-        usbStartTransmitI(&USB_DRIVER, SHARED_IN_EPNUM, (uint8_t *)report, sizeof(struct nkro_report));
+        report_queue_send(SHARED_IN_EPNUM, report, sizeof(struct nkro_report), true, TIME_INFINITE);
     } else
 #endif /* NKRO_ENABLE */
     {  /* regular protocol */
-        /* need to wait until the previous packet has made it through */
-        /* busy wait, should be short and not very common */
-        if (usbGetTransmitStatusI(&USB_DRIVER, KEYBOARD_IN_EPNUM)) {
-            /* Need to either suspend, or loop and call unlock/lock during
-             * every iteration - otherwise the system will remain locked,
-             * no interrupts served, so USB not going through as well.
-             * Note: for suspend, need USB_USE_WAIT == TRUE in halconf.h */
-            osalThreadSuspendS(&(&USB_DRIVER)->epc[KEYBOARD_IN_EPNUM]->in_state->thread);
-
-            /* after osalThreadSuspendS returns USB status might have changed */
-            if (usbGetDriverStateI(&USB_DRIVER) != USB_ACTIVE) {
-                goto unlock;
-            }
-        }
         uint8_t *data, size;
         if (keyboard_protocol) {
             data = (uint8_t *)report;
@@ -761,7 +891,8 @@ void send_keyboard(report_keyboard_t *report) {
             data = &report->mods;
             size = 8;
         }
-        usbStartTransmitI(&USB_DRIVER, KEYBOARD_IN_EPNUM, data, size);
+        /* only waits if the host falls behind by more than the queue */
+        report_queue_send(KEYBOARD_IN_EPNUM, data, size, true, TIME_INFINITE);
     }
     keyboard_report_sent = *report;
 
@@ -778,10 +909,7 @@ unlock:
 
 #    ifndef MOUSE_SHARED_EP
 /* mouse IN callback hander (a mouse report has made it IN) */
-void mouse_in_cb(USBDriver *usbp, usbep_t ep) {
-    (void)usbp;
-    (void)ep;
-}
+void mouse_in_cb(USBDriver *usbp, usbep_t ep) { report_queue_in_cb(usbp, ep); }
 #    endif
 
 void send_mouse(report_mouse_t *report) {
@@ -791,17 +919,33 @@ void send_mouse(report_mouse_t *report) {
         return;
     }
 
-    if (usbGetTransmitStatusI(&USB_DRIVER, MOUSE_IN_EPNUM)) {
-        /* Need to either suspend, or loop and call unlock/lock during
-         * every iteration - otherwise the system will remain locked,
-         * no interrupts served, so USB not going through as well.
-         * Note: for suspend, need USB_USE_WAIT == TRUE in halconf.h */
-        if (osalThreadSuspendTimeoutS(&(&USB_DRIVER)->epc[MOUSE_IN_EPNUM]->in_state->thread, TIME_MS2I(10)) == MSG_TIMEOUT) {
+    /* Movement is relative, so while the buttons stay the same a report that
+     * hasn't gone out yet can take this one's movement too. */
+    usb_report_t *pending = report_queue_pending_tail(report_queue(MOUSE_IN_EPNUM));
+    if (pending && pending->size == sizeof(report_mouse_t)) {
+        report_mouse_t *queued = (report_mouse_t *)pending->data;
+        int16_t         x      = queued->x + report->x;
+        int16_t         y      = queued->y + report->y;
+        int16_t         v      = queued->v + report->v;
+        int16_t         h      = queued->h + report->h;
+#    ifdef MOUSE_SHARED_EP
+        bool same_report = queued->report_id == report->report_id;
+#    else
+        bool same_report = true;
+#    endif
+        if (same_report && queued->buttons == report->buttons && x >= -127 && x <= 127 && y >= -127 && y <= 127 && v >= -127 && v <= 127 && h >= -127 && h <= 127) {
+            queued->x = x;
+            queued->y = y;
+            queued->v = v;
+            queued->h = h;
             osalSysUnlock();
             return;
         }
     }
-    usbStartTransmitI(&USB_DRIVER, MOUSE_IN_EPNUM, (uint8_t *)report, sizeof(report_mouse_t));
+
+    /* unlike button states, repeated movement isn't redundant */
+    bool moved = report->x || report->y || report->v || report->h;
+    report_queue_send(MOUSE_IN_EPNUM, report, sizeof(report_mouse_t), !moved, TIME_MS2I(10));
     osalSysUnlock();
 }
 
@@ -815,11 +959,7 @@ void   send_mouse(report_mouse_t *report) { (void)report; }
  */
 #ifdef SHARED_EP_ENABLE
 /* shared IN callback hander */
-void shared_in_cb(USBDriver *usbp, usbep_t ep) {
-    /* STUB */
-    (void)usbp;
-    (void)ep;
-}
+void shared_in_cb(USBDriver *usbp, usbep_t ep) { report_queue_in_cb(usbp, ep); }
 #endif
 
 /* ---------------------------------------------------------
@@ -837,7 +977,7 @@ static void send_extra(uint8_t report_id, uint16_t data) {
 
     report_extra_t report = {.report_id = report_id, .usage = data};
 
-    usbStartTransmitI(&USB_DRIVER, SHARED_IN_EPNUM, (uint8_t *)&report, sizeof(report_extra_t));
+    report_queue_send(SHARED_IN_EPNUM, &report, sizeof(report_extra_t), true, TIME_INFINITE);
     osalSysUnlock();
 }
 #endif